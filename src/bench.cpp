@@ -0,0 +1,544 @@
+//
+//  bench.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+#include "sprite.hpp"
+#include "world.hpp"
+#include "worldfile.hpp"
+#include "columns.hpp"
+#include "jobs.hpp"
+#include "noise.hpp"
+#include "bench.hpp"
+
+Bench_Stats compute_bench_stats( const std::vector<double>& samples ) {
+	Bench_Stats stats;
+	stats.count = (int)samples.size();
+	if ( samples.empty() ) return stats;
+
+	std::vector<double> sorted = samples;
+	std::sort( sorted.begin(), sorted.end() );
+	stats.min = sorted.front();
+	stats.max = sorted.back();
+	stats.median = ( sorted.size() % 2 ) ? sorted[sorted.size()/2] : ( sorted[sorted.size()/2-1] + sorted[sorted.size()/2] ) * 0.5;
+
+	for ( double s : samples ) stats.mean += s;
+	stats.mean /= samples.size();
+
+	for ( double s : samples ) stats.variance += (s - stats.mean) * (s - stats.mean);
+	if ( samples.size() > 1 ) stats.variance /= samples.size() - 1;
+	else stats.variance = 0;
+	stats.stddev = sqrt( stats.variance );
+
+	return stats;
+}
+
+void write_bench_stats_json( FILE* file, const Bench_Stats& stats, double units_per_sample, const char* unit_name ) {
+	fprintf( file, "{ \"mean_ms\": %.6f, \"median_ms\": %.6f, \"min_ms\": %.6f, \"max_ms\": %.6f, \"stddev_ms\": %.6f, \"variance_ms2\": %.6f",
+		stats.mean, stats.median, stats.min, stats.max, stats.stddev, stats.variance );
+	if ( units_per_sample > 0 ) fprintf( file, ", \"ns_per_%s\": %.4f", unit_name, stats.mean * 1000000.0 / units_per_sample );
+	fprintf( file, " }" );
+}
+
+static double elapsed_ms( uint64_t start ) {
+	return (get_time_ns() - start) / 1000000.0;
+}
+
+int run_world_generation_benchmark( int iterations, const char* json_path ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const double voxels = (double)world.size_x * world.size_y * world.size_z;
+
+	std::vector<double> heightmap, terrain, caves, ramps, columns, total;
+	for ( int i = 0; i < iterations; ++i ) {
+		uint64_t start = get_time_ns();
+
+		uint64_t phase_start = get_time_ns();
+		generate_world_heightmap();
+		heightmap.push_back( elapsed_ms( phase_start ) );
+
+		phase_start = get_time_ns();
+		generate_world_terrain();
+		terrain.push_back( elapsed_ms( phase_start ) );
+
+		phase_start = get_time_ns();
+		generate_world_caves();
+		caves.push_back( elapsed_ms( phase_start ) );
+
+		phase_start = get_time_ns();
+		generate_world_ramps();
+		ramps.push_back( elapsed_ms( phase_start ) );
+
+		total.push_back( elapsed_ms( start ) );
+
+		// The columns are built on their first query rather than by generate_world(), so they aren't in the total.
+		phase_start = get_time_ns();
+		build_world_columns();
+		columns.push_back( elapsed_ms( phase_start ) );
+		fprintf( stderr, "generate_world %d/%d: %.2f ms (heightmap %.2f, terrain %.2f, caves %.2f, ramps %.2f), columns %.2f\n", i+1, iterations, total.back(), heightmap.back(), terrain.back(), caves.back(), ramps.back(), columns.back() );
+	}
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"world_generation\",\n" );
+	fprintf( file, "  \"world\": { \"size_x\": %d, \"size_y\": %d, \"size_z\": %d, \"voxels\": %.0f },\n", world.size_x, world.size_y, world.size_z, voxels );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"phases\": {\n" );
+	fprintf( file, "    \"heightmap\": " ); write_bench_stats_json( file, compute_bench_stats( heightmap ), (double)world.size_x * world.size_z, "column" ); fprintf( file, ",\n" );
+	fprintf( file, "    \"terrain\": " ); write_bench_stats_json( file, compute_bench_stats( terrain ), voxels, "voxel" ); fprintf( file, ",\n" );
+	fprintf( file, "    \"caves\": " ); write_bench_stats_json( file, compute_bench_stats( caves ), voxels, "voxel" ); fprintf( file, ",\n" );
+	fprintf( file, "    \"ramps\": " ); write_bench_stats_json( file, compute_bench_stats( ramps ), voxels, "voxel" ); fprintf( file, "\n" );
+	fprintf( file, "  },\n" );
+	fprintf( file, "  \"total\": " ); write_bench_stats_json( file, compute_bench_stats( total ), voxels, "voxel" ); fprintf( file, ",\n" );
+	fprintf( file, "  \"columns_on_first_query\": " ); write_bench_stats_json( file, compute_bench_stats( columns ), (double)world.size_x * world.size_z, "column" ); fprintf( file, "\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+	return 0;
+}
+
+// Meshes every layer the way generate_world_mesh() does, minus the
+// buildTexturedSpriteBatch() upload, so it only measures the CPU side.
+int run_world_meshing_benchmark( int iterations, const char* json_path ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const double voxels = (double)world.size_x * world.size_y * world.size_z;
+
+	fprintf( stderr, "Generating world...\n" );
+	generate_world();
+
+	std::vector<Tile_Quad> quads;
+	std::vector<double> classify, emit, total;
+	size_t quad_count = 0;
+	size_t byte_count = 0;
+	for ( int i = 0; i < iterations; ++i ) {
+		double classify_ms = 0;
+		double emit_ms = 0;
+		quad_count = 0;
+		byte_count = 0;
+
+		for ( int y = 0; y < world.size_y; ++y ) {
+			uint64_t start = get_time_ns();
+			quads.clear();
+			classify_world_layer( y, true, quads );
+			classify_ms += elapsed_ms( start );
+
+			start = get_time_ns();
+			TexturedSpriteBatch* sb = &world.tile_sb[y];
+			prepairTexturedSpriteBatchForPush( sb );
+			emit_world_layer( sb, quads );
+			emit_ms += elapsed_ms( start );
+
+			quad_count += quads.size();
+			byte_count += sb->vertices.size() * sizeof(GLfloat) + sb->vertex_tex.size() * sizeof(float) + sb->vertex_colors.size() * sizeof(unsigned char) + sb->indices.size() * sizeof(unsigned int);
+		}
+
+		classify.push_back( classify_ms );
+		emit.push_back( emit_ms );
+		total.push_back( classify_ms + emit_ms );
+		fprintf( stderr, "generate_world_mesh %d/%d: %.2f ms (classify %.2f, emit %.2f), %zu quads\n", i+1, iterations, total.back(), classify_ms, emit_ms, quad_count );
+	}
+
+	Bench_Stats total_stats = compute_bench_stats( total );
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"world_meshing\",\n" );
+	fprintf( file, "  \"world\": { \"size_x\": %d, \"size_y\": %d, \"size_z\": %d, \"voxels\": %.0f },\n", world.size_x, world.size_y, world.size_z, voxels );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"layers\": %d,\n", world.size_y );
+	fprintf( file, "  \"quads\": %zu,\n", quad_count );
+	fprintf( file, "  \"bytes\": %zu,\n", byte_count );
+	fprintf( file, "  \"quads_per_second\": %.0f,\n", total_stats.mean > 0 ? quad_count / (total_stats.mean / 1000.0) : 0.0 );
+	fprintf( file, "  \"phases\": {\n" );
+	fprintf( file, "    \"classify\": " ); write_bench_stats_json( file, compute_bench_stats( classify ), voxels, "voxel" ); fprintf( file, ",\n" );
+	fprintf( file, "    \"emit\": " ); write_bench_stats_json( file, compute_bench_stats( emit ), (double)quad_count, "quad" ); fprintf( file, "\n" );
+	fprintf( file, "  },\n" );
+	fprintf( file, "  \"total\": " ); write_bench_stats_json( file, total_stats, (double)quad_count, "quad" ); fprintf( file, "\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+	return 0;
+}
+
+// Generates and meshes the same world once per chunk layout. The quads have to come out
+// the same for both, so the check sum doubles as a test that the layouts agree.
+int run_world_layout_benchmark( int iterations, const char* json_path ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const double voxels = (double)world.size_x * world.size_y * world.size_z;
+	const Chunk_Layout layouts[] = { CHUNK_LINEAR, CHUNK_MORTON };
+	const char* layout_names[] = { "linear", "morton" };
+
+	std::vector<double> generate[2], classify[2];
+	size_t quad_count[2] = { 0, 0 };
+	uint64_t quad_hash[2] = { 0, 0 };
+	std::vector<Tile_Quad> quads;
+	for ( int l = 0; l < 2; ++l ) {
+		create_world( world.size_x, world.size_y, world.size_z, layouts[l] );
+		for ( int i = 0; i < iterations; ++i ) {
+			uint64_t start = get_time_ns();
+			generate_world();
+			generate[l].push_back( elapsed_ms( start ) );
+
+			start = get_time_ns();
+			quad_count[l] = 0;
+			quad_hash[l] = 1469598103934665603ULL;
+			for ( int y = 0; y < world.size_y; ++y ) {
+				quads.clear();
+				classify_world_layer( y, true, quads );
+				quad_count[l] += quads.size();
+				for ( const Tile_Quad& quad : quads ) {
+					const unsigned char* bytes = (const unsigned char*)&quad;
+					for ( size_t b = 0; b < sizeof(Tile_Quad); ++b ) quad_hash[l] = ( quad_hash[l] ^ bytes[b] ) * 1099511628211ULL;
+				}
+			}
+			classify[l].push_back( elapsed_ms( start ) );
+			fprintf( stderr, "%s %d/%d: generate_world %.2f ms, classify %.2f ms, %zu quads\n", layout_names[l], i+1, iterations, generate[l].back(), classify[l].back(), quad_count[l] );
+		}
+	}
+	bool identical = quad_count[0] == quad_count[1] && quad_hash[0] == quad_hash[1];
+	if ( !identical ) fprintf( stderr, "The layouts produced different meshes!\n" );
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"world_layout\",\n" );
+	fprintf( file, "  \"world\": { \"size_x\": %d, \"size_y\": %d, \"size_z\": %d, \"voxels\": %.0f },\n", world.size_x, world.size_y, world.size_z, voxels );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"identical_meshes\": %s,\n", identical ? "true" : "false" );
+	fprintf( file, "  \"layouts\": {\n" );
+	for ( int l = 0; l < 2; ++l ) {
+		fprintf( file, "    \"%s\": {\n", layout_names[l] );
+		fprintf( file, "      \"quads\": %zu,\n", quad_count[l] );
+		fprintf( file, "      \"generate_world\": " ); write_bench_stats_json( file, compute_bench_stats( generate[l] ), voxels, "voxel" ); fprintf( file, ",\n" );
+		fprintf( file, "      \"classify\": " ); write_bench_stats_json( file, compute_bench_stats( classify[l] ), voxels, "voxel" ); fprintf( file, "\n" );
+		fprintf( file, "    }%s\n", l == 0 ? "," : "" );
+	}
+	fprintf( file, "  }\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+
+	// Leave the world the way it was asked for.
+	create_world( world.size_x, world.size_y, world.size_z );
+	return identical ? 0 : 1;
+}
+
+int run_world_file_benchmark( int iterations, const char* json_path, const char* filename ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const double voxels = (double)world.size_x * world.size_y * world.size_z;
+
+	uint64_t start = get_time_ns();
+	generate_world();
+	double generate_ms = elapsed_ms( start );
+
+	start = get_time_ns();
+	if ( !save_world_file( filename ) ) return 1;
+	double save_ms = elapsed_ms( start );
+
+	FILE* saved = fopen( filename, "rb" );
+	long file_bytes = 0;
+	if ( saved ) { fseek( saved, 0, SEEK_END ); file_bytes = ftell( saved ); fclose( saved ); }
+
+	// What the loaded world is checked against.
+	World_Snapshot generated = snapshot_world();
+	std::vector<uint64_t> planes[WORLD_PLANES];
+	for ( int p = 0; p < WORLD_PLANES; ++p ) planes[p] = world.planes[p];
+
+	std::vector<double> load;
+	bool identical = true;
+	for ( int i = 0; i < iterations; ++i ) {
+		start = get_time_ns();
+		if ( !load_world_file( filename ) ) return 1;
+		load.push_back( elapsed_ms( start ) );
+		fprintf( stderr, "%d/%d: load_world_file %.2f ms ( generate_world %.2f ms )\n", i+1, iterations, load.back(), generate_ms );
+	}
+
+	for ( int p = 0; p < WORLD_PLANES; ++p ) identical = identical && planes[p] == world.planes[p];
+	for ( int y = 0; identical && y < world.size_y; ++y ) {
+		for ( int z = 0; z < world.size_z; ++z ) {
+			for ( int x = 0; x < world.size_x; ++x ) {
+				if ( get_world_tile( y, z, x ).bits != get_snapshot_tile( generated, y, z, x ).bits ) identical = false;
+			}
+		}
+	}
+	if ( !identical ) fprintf( stderr, "The loaded world differs from the generated one!\n" );
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"world_file\",\n" );
+	fprintf( file, "  \"world\": { \"size_x\": %d, \"size_y\": %d, \"size_z\": %d, \"voxels\": %.0f },\n", world.size_x, world.size_y, world.size_z, voxels );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"file_bytes\": %ld,\n", file_bytes );
+	fprintf( file, "  \"identical\": %s,\n", identical ? "true" : "false" );
+	fprintf( file, "  \"generate_world_ms\": %.6f,\n", generate_ms );
+	fprintf( file, "  \"save_world_file_ms\": %.6f,\n", save_ms );
+	fprintf( file, "  \"load_world_file\": " ); write_bench_stats_json( file, compute_bench_stats( load ), voxels, "voxel" ); fprintf( file, "\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+	return identical ? 0 : 1;
+}
+
+static void hash_bytes( uint64_t& hash, const void* data, size_t bytes ) {
+	const unsigned char* p = (const unsigned char*)data;
+	for ( size_t i = 0; i < bytes; ++i ) hash = ( hash ^ p[i] ) * 1099511628211ULL;
+}
+
+// Everything generate_world() produces: the chunks as encoded and the planes, and the columns built from them.
+static uint64_t hash_world() {
+	uint64_t hash = 1469598103934665603ULL;
+	for ( const Chunk& chunk : world.chunks ) {
+		hash_bytes( hash, &chunk.uniform, sizeof(Tile) );
+		if ( !chunk.data ) continue;
+		const Chunk_Data& data = *chunk.data;
+		hash_bytes( hash, data.tiles.data(), data.tiles.size() * sizeof(Tile) );
+		hash_bytes( hash, data.palette.data(), data.palette.size() * sizeof(Tile) );
+		hash_bytes( hash, data.indices.data(), data.indices.size() * sizeof(uint64_t) );
+		hash_bytes( hash, &data.index_bits, sizeof(data.index_bits) );
+	}
+	for ( int p = 0; p < WORLD_PLANES; ++p ) hash_bytes( hash, world.planes[p].data(), world.planes[p].size() * sizeof(uint64_t) );
+	for ( int z = 0; z < world.size_z; ++z ) {
+		for ( int x = 0; x < world.size_x; ++x ) {
+			const Column_Run* runs;
+			int count = get_world_column( z, x, &runs );
+			for ( int r = 0; r < count; ++r ) { hash_bytes( hash, &runs[r].top, sizeof(runs[r].top) ); hash_bytes( hash, &runs[r].tile, sizeof(Tile) ); }
+		}
+	}
+	return hash;
+}
+
+int run_world_threads_benchmark( int iterations, const char* json_path ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const double voxels = (double)world.size_x * world.size_y * world.size_z;
+	int max_threads = job_threads();
+
+	std::vector<int> counts;
+	for ( int count = 1; count < max_threads; count *= 2 ) counts.push_back( count );
+	counts.push_back( max_threads );
+
+	std::vector< std::vector<double> > terrain( counts.size() ), caves( counts.size() ), ramps( counts.size() ), total( counts.size() );
+	std::vector<uint64_t> hashes( counts.size() );
+	bool identical = true;
+	for ( size_t c = 0; c < counts.size(); ++c ) {
+		set_job_threads( counts[c] );
+		for ( int i = 0; i < iterations; ++i ) {
+			uint64_t start = get_time_ns();
+
+			uint64_t phase_start = get_time_ns();
+			generate_world_terrain();
+			terrain[c].push_back( elapsed_ms( phase_start ) );
+
+			phase_start = get_time_ns();
+			generate_world_caves();
+			caves[c].push_back( elapsed_ms( phase_start ) );
+
+			phase_start = get_time_ns();
+			generate_world_ramps();
+			ramps[c].push_back( elapsed_ms( phase_start ) );
+
+			total[c].push_back( elapsed_ms( start ) );
+			fprintf( stderr, "%d threads %d/%d: %.2f ms (terrain %.2f, caves %.2f, ramps %.2f)\n", counts[c], i+1, iterations, total[c].back(), terrain[c].back(), caves[c].back(), ramps[c].back() );
+		}
+		hashes[c] = hash_world();
+		if ( hashes[c] != hashes[0] ) identical = false;
+	}
+	set_job_threads( max_threads );
+	if ( !identical ) fprintf( stderr, "The thread counts generated different worlds!\n" );
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	double single_ms = compute_bench_stats( total[0] ).mean;
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"world_threads\",\n" );
+	fprintf( file, "  \"world\": { \"size_x\": %d, \"size_y\": %d, \"size_z\": %d, \"voxels\": %.0f },\n", world.size_x, world.size_y, world.size_z, voxels );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"identical_worlds\": %s,\n", identical ? "true" : "false" );
+	fprintf( file, "  \"threads\": [\n" );
+	for ( size_t c = 0; c < counts.size(); ++c ) {
+		Bench_Stats stats = compute_bench_stats( total[c] );
+		fprintf( file, "    {\n" );
+		fprintf( file, "      \"threads\": %d,\n", counts[c] );
+		fprintf( file, "      \"hash\": \"%016llx\",\n", (unsigned long long)hashes[c] );
+		fprintf( file, "      \"speedup\": %.3f,\n", stats.mean > 0 ? single_ms / stats.mean : 0.0 );
+		fprintf( file, "      \"terrain\": " ); write_bench_stats_json( file, compute_bench_stats( terrain[c] ), voxels, "voxel" ); fprintf( file, ",\n" );
+		fprintf( file, "      \"caves\": " ); write_bench_stats_json( file, compute_bench_stats( caves[c] ), voxels, "voxel" ); fprintf( file, ",\n" );
+		fprintf( file, "      \"ramps\": " ); write_bench_stats_json( file, compute_bench_stats( ramps[c] ), voxels, "voxel" ); fprintf( file, ",\n" );
+		fprintf( file, "      \"total\": " ); write_bench_stats_json( file, stats, voxels, "voxel" ); fprintf( file, "\n" );
+		fprintf( file, "    }%s\n", c+1 < counts.size() ? "," : "" );
+	}
+	fprintf( file, "  ]\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+	return identical ? 0 : 1;
+}
+
+// Rows of sample points like the generator's: a row of x from a random start, at a random y ( and z ).
+struct Noise_Bench_Row {
+	std::vector<float> x;
+	float y;
+	float z;
+};
+
+static void time_noise_rows( Noise_Kernel kernel, bool simplex, int octaves, const std::vector<Noise_Bench_Row>& rows, std::vector< std::vector<float> >& out, int iterations, std::vector<double>& times ) {
+	out.resize( rows.size() );
+	for ( int i = 0; i < iterations; ++i ) {
+		uint64_t start = get_time_ns();
+		for ( size_t r = 0; r < rows.size(); ++r ) {
+			const Noise_Bench_Row& row = rows[r];
+			out[r].resize( row.x.size() );
+			if ( simplex ) simplex_noise_row( kernel, octaves, row.x.data(), row.y, row.z, out[r].data(), (int)row.x.size() );
+			else noise_2d_row( kernel, row.x.data(), row.y, out[r].data(), (int)row.x.size() );
+		}
+		times.push_back( elapsed_ms( start ) );
+	}
+}
+
+int run_noise_benchmark( int iterations, const char* json_path ) {
+
+	if ( iterations < 1 ) iterations = 1;
+	const int row_count = 2048;
+	const int octaves = world_generator.cave_octaves;
+
+	// The rows are as long as a chunk or a world row, plus a few that end part way through a group of lanes.
+	std::vector<Noise_Bench_Row> rows( row_count );
+	uint32_t seed = 12345;
+	auto random = [&]( float low, float high ) { seed = seed * 1664525u + 1013904223u; return low + ( high - low ) * ( seed >> 8 ) / 16777216.0f; };
+	double samples = 0;
+	for ( int r = 0; r < row_count; ++r ) {
+		static const int lengths[] = { 16, 128, 13, 7 };
+		Noise_Bench_Row& row = rows[r];
+		float step = random( 0.001f, 0.5f );
+		float x = random( -200, 200 );
+		row.x.resize( lengths[ r % 4 ] );
+		for ( float& value : row.x ) { value = x; x += step; }
+		row.y = random( -200, 200 );
+		row.z = random( -200, 200 );
+		samples += row.x.size();
+	}
+
+	const char* names[] = { "noise_2d", "simplex_noise" };
+	std::vector<double> scalar_ms( 2 );
+	std::vector< std::vector<float> > expected[2];
+	struct Result { Noise_Kernel kernel; int noise; Bench_Stats stats; double max_error; int differing; };
+	std::vector<Result> results;
+	bool within_tolerance = true;
+	for ( int noise = 0; noise < 2; ++noise ) {
+		for ( int k = 0; k < NOISE_KERNEL_COUNT; ++k ) {
+			Noise_Kernel kernel = (Noise_Kernel)k;
+			if ( !noise_kernel_supported( kernel ) ) continue;
+			std::vector<double> times;
+			std::vector< std::vector<float> > out;
+			time_noise_rows( kernel, noise == 1, octaves, rows, kernel == NOISE_SCALAR ? expected[noise] : out, iterations, times );
+
+			Result result = { kernel, noise, compute_bench_stats( times ), 0, 0 };
+			if ( kernel != NOISE_SCALAR ) {
+				for ( size_t r = 0; r < rows.size(); ++r ) {
+					for ( size_t i = 0; i < out[r].size(); ++i ) {
+						double error = fabs( (double)out[r][i] - expected[noise][r][i] );
+						if ( !( error <= result.max_error ) ) result.max_error = error; // Also catches a NaN.
+						if ( out[r][i] != expected[noise][r][i] ) result.differing++;
+					}
+				}
+			}
+			if ( !( result.max_error <= NOISE_ROW_TOLERANCE ) ) within_tolerance = false;
+			if ( kernel == NOISE_SCALAR ) scalar_ms[noise] = result.stats.mean;
+			results.push_back( result );
+			fprintf( stderr, "%s %s: %.2f ms, max error %g, %d differ\n", names[noise], noise_kernel_name( kernel ), result.stats.mean, result.max_error, result.differing );
+		}
+	}
+	if ( !within_tolerance ) fprintf( stderr, "A noise kernel is further than %g from the scalar noise!\n", NOISE_ROW_TOLERANCE );
+
+	// The caves' fractal noise against simplex_noise(), and the threshold test with the early out
+	// against comparing the full sums, at the caves' threshold and at thresholds around the middle.
+	Fractal_Noise fractal = make_fractal_noise( FRACTAL_SIMPLEX, octaves, 1, 1, 2 );
+	std::vector<double> fractal_times, below_times;
+	int fractal_differing = 0;
+	for ( int i = 0; i < iterations; ++i ) {
+		uint64_t start = get_time_ns();
+		for ( size_t r = 0; r < rows.size(); ++r ) {
+			std::vector<float> out( rows[r].x.size() );
+			fractal_noise_row( fractal, rows[r].x.data(), rows[r].y, rows[r].z, out.data(), (int)out.size() );
+			if ( i == 0 ) for ( size_t p = 0; p < out.size(); ++p ) if ( out[p] != expected[1][r][p] ) fractal_differing++;
+		}
+		fractal_times.push_back( elapsed_ms( start ) );
+	}
+
+	const float thresholds[] = { world_generator.cave_threshold, 0.9f * octaves, 1.1f * octaves };
+	const int threshold_count = sizeof(thresholds) / sizeof(thresholds[0]);
+	double octaves_evaluated[threshold_count] = {};
+	int below_mismatches = 0;
+	for ( int t = 0; t < threshold_count; ++t ) {
+		for ( int i = 0; i < iterations; ++i ) {
+			uint64_t start = get_time_ns();
+			for ( size_t r = 0; r < rows.size(); ++r ) {
+				std::vector<uint8_t> below( rows[r].x.size() );
+				int evaluated = fractal_noise_below_row( fractal, rows[r].x.data(), rows[r].y, rows[r].z, thresholds[t], below.data(), (int)below.size() );
+				if ( i > 0 ) continue;
+				octaves_evaluated[t] += evaluated;
+				for ( size_t p = 0; p < below.size(); ++p ) if ( below[p] != ( expected[1][r][p] < thresholds[t] ) ) below_mismatches++;
+			}
+			if ( t == 0 ) below_times.push_back( elapsed_ms( start ) );
+		}
+	}
+	fprintf( stderr, "fractal_noise_row: %.2f ms, %d differ from simplex_noise\n", compute_bench_stats( fractal_times ).mean, fractal_differing );
+	fprintf( stderr, "fractal_noise_below_row: %.2f ms, %.1f%% of the octaves, %d wrong\n", compute_bench_stats( below_times ).mean, 100.0 * octaves_evaluated[0] / ( samples * octaves ), below_mismatches );
+	bool fractal_ok = fractal_differing == 0 && below_mismatches == 0;
+	if ( !fractal_ok ) fprintf( stderr, "The fractal noise differs from simplex_noise!\n" );
+
+	FILE* file = json_path ? fopen( json_path, "w" ) : stdout;
+	if ( !file ) { fprintf( stderr, "Unable to open %s\n", json_path ); return 1; }
+
+	fprintf( file, "{\n" );
+	fprintf( file, "  \"benchmark\": \"noise\",\n" );
+	fprintf( file, "  \"iterations\": %d,\n", iterations );
+	fprintf( file, "  \"samples\": %.0f,\n", samples );
+	fprintf( file, "  \"simplex_octaves\": %d,\n", octaves );
+	fprintf( file, "  \"tolerance\": %g,\n", NOISE_ROW_TOLERANCE );
+	fprintf( file, "  \"within_tolerance\": %s,\n", within_tolerance ? "true" : "false" );
+	fprintf( file, "  \"kernels\": [\n" );
+	for ( size_t r = 0; r < results.size(); ++r ) {
+		const Result& result = results[r];
+		fprintf( file, "    { \"noise\": \"%s\", \"kernel\": \"%s\", \"max_error\": %g, \"differing_samples\": %d, \"speedup\": %.3f,\n",
+			names[result.noise], noise_kernel_name( result.kernel ), result.max_error, result.differing, result.stats.mean > 0 ? scalar_ms[result.noise] / result.stats.mean : 0.0 );
+		fprintf( file, "      \"time\": " ); write_bench_stats_json( file, result.stats, samples, "sample" ); fprintf( file, " }%s\n", r+1 < results.size() ? "," : "" );
+	}
+	fprintf( file, "  ],\n" );
+	fprintf( file, "  \"fractal\": {\n" );
+	fprintf( file, "    \"kernel\": \"%s\",\n", noise_kernel_name( noise_kernel() ) );
+	fprintf( file, "    \"differing_samples\": %d,\n", fractal_differing );
+	fprintf( file, "    \"below_mismatches\": %d,\n", below_mismatches );
+	fprintf( file, "    \"octaves_evaluated\": [" );
+	for ( int t = 0; t < threshold_count; ++t ) fprintf( file, "%s{ \"threshold\": %g, \"fraction\": %.4f }", t ? ", " : " ", thresholds[t], octaves_evaluated[t] / ( samples * octaves ) );
+	fprintf( file, " ],\n" );
+	fprintf( file, "    \"row\": " ); write_bench_stats_json( file, compute_bench_stats( fractal_times ), samples, "sample" ); fprintf( file, ",\n" );
+	fprintf( file, "    \"below_row\": " ); write_bench_stats_json( file, compute_bench_stats( below_times ), samples, "sample" ); fprintf( file, "\n" );
+	fprintf( file, "  }\n" );
+	fprintf( file, "}\n" );
+
+	if ( file != stdout ) fclose( file );
+	return within_tolerance && fractal_ok ? 0 : 1;
+}
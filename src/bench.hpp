@@ -0,0 +1,37 @@
+//
+//  bench.hpp
+//  Isometric Demo
+//
+//  Benchmarks for the startup hot paths. They are run from the
+//  headless build ( IsoDemo --bench <name> ) and print JSON.
+//
+
+#ifndef _bench_hpp_
+#define _bench_hpp_
+
+struct Bench_Stats {
+	int count = 0;
+	double mean = 0;
+	double min = 0;
+	double max = 0;
+	double median = 0;
+	double variance = 0;
+	double stddev = 0;
+};
+
+Bench_Stats compute_bench_stats( const std::vector<double>& samples );
+
+// Writes the stats as a JSON object ( without a trailing newline ).
+// 'units_per_sample' is used to report the cost per unit, eg. per voxel.
+void write_bench_stats_json( FILE* file, const Bench_Stats& stats, double units_per_sample, const char* unit_name );
+
+// Each of these returns the process exit code.
+// If 'json_path' is null the JSON report is written to stdout.
+int run_world_generation_benchmark( int iterations, const char* json_path );
+int run_world_meshing_benchmark( int iterations, const char* json_path );
+int run_world_layout_benchmark( int iterations, const char* json_path ); // Linear vs Morton chunk layout.
+int run_world_threads_benchmark( int iterations, const char* json_path ); // generate_world() at 1, 2, 4.. threads, up to job_threads().
+int run_world_file_benchmark( int iterations, const char* json_path, const char* filename ); // Generating vs loading a saved world.
+int run_noise_benchmark( int iterations, const char* json_path ); // The row noise kernels and the fractal noise against the scalar noise, fails if they don't match.
+
+#endif
@@ -0,0 +1,155 @@
+//
+//  columns.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <atomic>
+
+#include "sprite.hpp"
+#include "world.hpp"
+#include "columns.hpp"
+#include "jobs.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+
+// A row of columns ( one z ) keeps its runs back to back, column x starts at starts[x], and
+// starts[size_x] is one past the last run. An edit only moves the runs and starts of its own row.
+struct Column_Row {
+	std::vector<uint32_t> starts;
+	std::vector<Column_Run> runs;
+};
+
+static std::vector<Column_Row> column_rows;
+static size_t column_run_total = 0;
+static size_t column_bytes = 0;
+
+static size_t column_row_bytes( const Column_Row& row ) {
+	return sizeof(Column_Row) + row.starts.capacity() * sizeof(uint32_t) + row.runs.capacity() * sizeof(Column_Run);
+}
+
+static void track_world_columns() {
+	memory_track_cpu( &column_rows, "world columns", world_column_bytes() );
+}
+
+static void count_world_columns() {
+	column_run_total = 0;
+	column_bytes = 0;
+	for ( const Column_Row& row : column_rows ) {
+		column_run_total += row.runs.size();
+		column_bytes += column_row_bytes( row );
+	}
+	track_world_columns();
+}
+
+static void extend_column( std::vector<Column_Run>& runs, int top, Tile tile ) {
+	if ( !runs.empty() && runs.back().tile.bits == tile.bits ) runs.back().top = (uint16_t)top;
+	else { Column_Run run = { (uint16_t)top, tile }; runs.push_back( run ); }
+}
+
+// A chunk at a time, so a uniform chunk ( most of them: the air and the stone ) is one step rather than 16 tiles.
+static void read_column( int z, int x, std::vector<Column_Run>& runs ) {
+	runs.clear();
+	for ( int y = 0; y < world.size_y; y += CHUNK_SIZE ) {
+		const Chunk& chunk = world_chunk( y, z, x );
+		if ( !chunk.data ) { extend_column( runs, y + CHUNK_SIZE, chunk.uniform ); continue; }
+		for ( int cy = y; cy < y + CHUNK_SIZE; ++cy ) extend_column( runs, cy + 1, chunk_tile( chunk, chunk_tile_index( world.layout, cy, z, x ) ) );
+	}
+}
+
+// A job per row of columns.
+void build_world_columns() {
+	TRACE_SCOPE( "build_world_columns" );
+
+	column_rows.resize( world.size_z );
+	run_jobs( world.size_z, [&]( int z ) {
+		Column_Row& row = column_rows[z];
+		row.starts.resize( world.size_x + 1 );
+		row.runs.clear();
+		std::vector<Column_Run> runs;
+		for ( int x = 0; x < world.size_x; ++x ) {
+			row.starts[x] = (uint32_t)row.runs.size();
+			read_column( z, x, runs );
+			row.runs.insert( row.runs.end(), runs.begin(), runs.end() );
+		}
+		row.starts[ world.size_x ] = (uint32_t)row.runs.size();
+		row.runs.shrink_to_fit();
+	} );
+	count_world_columns();
+}
+
+void clear_world_columns() {
+	std::vector<Column_Row>().swap( column_rows );
+	count_world_columns();
+}
+
+bool world_columns_built() {
+	return !column_rows.empty();
+}
+
+void update_world_column( int z, int x ) {
+	if ( column_rows.empty() ) return;
+
+	std::vector<Column_Run> runs;
+	read_column( z, x, runs );
+
+	Column_Row& row = column_rows[z];
+	uint32_t start = row.starts[x];
+	uint32_t end = row.starts[x+1];
+	int change = (int)runs.size() - (int)( end - start );
+	size_t bytes = column_row_bytes( row );
+	if ( change > 0 ) row.runs.insert( row.runs.begin() + end, change, Column_Run() );
+	else if ( change < 0 ) row.runs.erase( row.runs.begin() + end + change, row.runs.begin() + end );
+	for ( size_t i = 0; i < runs.size(); ++i ) row.runs[start + i] = runs[i];
+
+	if ( change != 0 ) {
+		for ( int i = x + 1; i <= world.size_x; ++i ) row.starts[i] += change;
+		column_run_total += change;
+		column_bytes += column_row_bytes( row ) - bytes;
+		track_world_columns();
+	}
+}
+
+int get_world_column( int z, int x, const Column_Run** runs ) {
+	if ( column_rows.empty() ) build_world_columns();
+	const Column_Row& row = column_rows[z];
+	*runs = &row.runs[ row.starts[x] ];
+	return (int)( row.starts[x+1] - row.starts[x] );
+}
+
+// The highest layer below 'below' in a run whose tile passes 'test'.
+template <typename Test>
+static int column_find_from_top( int z, int x, int below, Test test ) {
+	const Column_Run* runs;
+	int count = get_world_column( z, x, &runs );
+	for ( int r = count-1; r >= 0; --r ) {
+		int bottom = r > 0 ? runs[r-1].top : 0;
+		if ( bottom >= below ) continue;
+		if ( test( runs[r].tile ) ) return std::min( (int)runs[r].top, below ) - 1;
+	}
+	return -1;
+}
+
+int column_top_solid( int z, int x, int below ) {
+	return column_find_from_top( z, x, below, []( Tile tile ) { return tile_is_full( tile ); } );
+}
+
+int column_first_visible( int z, int x, int below ) {
+	return column_find_from_top( z, x, below, []( Tile tile ) { return tile_type( tile ) != AIR; } );
+}
+
+size_t world_column_run_count() {
+	return column_run_total;
+}
+
+size_t world_column_bytes() {
+	return column_bytes;
+}
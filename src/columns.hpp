@@ -0,0 +1,43 @@
+//
+//  columns.hpp
+//  Isometric Demo
+//
+//  A run length encoded copy of the world, one column of tiles per ( x, z ).
+//  The generated terrain is mostly vertical runs ( stone up to the height,
+//  a dirt tile and air above, broken by lava ), so a column is only a handful
+//  of runs however tall the world is. Top down queries ( eg. the highest solid
+//  tile under the cursor ) walk the runs of a column from the top.
+//
+//  The columns are built from the chunks the first time they are queried, and
+//  then set_world_tile() keeps the edited column up to date. Anything else that
+//  rewrites the chunks ( generating, loading, undo ) clears them to be rebuilt.
+//  They are kept a row ( z ) at a time, so an edit that adds or removes runs
+//  only moves the rest of its row.
+//
+
+#ifndef _columns_hpp_
+#define _columns_hpp_
+
+// The runs of a column go from the bottom of the world up. A run covers
+// the layers from the 'top' of the run below it up to its own 'top'.
+struct Column_Run {
+	uint16_t top; // One past the highest layer of the run.
+	Tile tile;
+};
+
+void build_world_columns(); // Queries call it when the columns aren't built.
+void clear_world_columns();
+bool world_columns_built();
+void update_world_column( int z, int x ); // Re-reads the column from the chunks.
+
+int get_world_column( int z, int x, const Column_Run** runs ); // Returns the number of runs.
+
+// The highest layer below 'below' that holds a full tile ( top solid ) or any tile other than air
+// ( first visible, as seen from above with the layers from 'below' up cut away ). -1 if there is none.
+int column_top_solid( int z, int x, int below );
+int column_first_visible( int z, int x, int below );
+
+size_t world_column_run_count();
+size_t world_column_bytes();
+
+#endif
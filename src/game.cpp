@@ -1,71 +1,37 @@
-#include <OpenGL/gl3.h>
+#include "platform.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
 #include FT_FREETYPE_H
-#include <mach/mach_time.h>
 
+#include <stdio.h>
+#include <string.h>
 #include <vector>
+#include <memory>
 #include <string>
+#include <atomic>
 
 #include "debug.hpp"
+#include "game.hpp"
 #include "text.hpp"
 #include "shader.hpp"
 #include "sprite.hpp"
 #include "mainmenu.hpp"
-#include "perlin.hpp"
-#include "simplex.hpp"
-
-enum Tile_Type {
-	AIR = 0,
-
-	DIRT = 1,
-	DIRT_RAMP = 2,
-
-	STONE = 3,
-
-	WOOD = 4,
-	WOOD_RAMP = 5,
-
-	LAVA = 6,
-};
-
-enum Direction {
-	NONE = 0,
-	XP = 1,
-	XN = 2,
-	ZP = 3,
-	ZN = 4,
-
-	XP_ZP = 5,
-	XN_ZN = 6,
-	XP_ZN = 7,
-	XN_ZP = 8,
-};
-
-struct Tile {
-	Tile_Type type = AIR;
-	Direction direction = NONE;
-	bool is_ramp = false;
-	bool is_full = false;
-};
-
-struct World {
-	static const int SIZE_X = 128;
-	static const int SIZE_Z = 128;
-	static const int SIZE_Y = 128;
-	Tile tiles[SIZE_Y][SIZE_Z][SIZE_X];
-
-	TexturedSpriteBatch tile_sb[SIZE_Y];
-	bool generated_full_sb[SIZE_Y];
-
-	unsigned int shaderID = 0;
-	unsigned int texID = 0;
-};
+#include "world.hpp"
+#include "columns.hpp"
+#include "worldfile.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+#include "startup.hpp"
+#include "gpu_timer.hpp"
+#include "replay.hpp"
 
 extern void refresh_after_resize();
 extern void hide_cursor();
 
+#define GAME_UNDO_LEVELS 32
+
 // Global Variables
 glm::vec2 window_size;
 glm::vec2 gl_viewport_size;
@@ -98,8 +64,15 @@ static Packed_Glyph_Texture debug_pgt;
 static Text_Mesh debug_text_mesh = {0};
 static unsigned int debug_text_shader_id;
 
-static World world;
-static unsigned int world_cutoff_height = World::SIZE_Y;
+static int world_cutoff_height = 0; // Set to the world height by init_game().
+
+// The cutoff shows layers 0 to cutoff-1, and the top one has to exist to be meshed without occlusion.
+static int clamp_cutoff_height( int cutoff_height ) {
+	return std::min( std::max( cutoff_height, 1 ), world.size_y );
+}
+
+static const char* world_file = nullptr;
+static const char* world_cache = WORLD_CACHE_DIRECTORY;
 
 static TexturedSpriteBatch cursor_sb;
 static unsigned int half_height_texture = 0;
@@ -107,261 +80,43 @@ static bool render_half_height = false;
 
 static bool cursor_disable_depth = false;
 
-//////////////////////
-/////////////
-/////////////////
-
-void resize_view( float ww, float wh, float glvw, float glvh );
-
-static float generateHeightmap ( float xx, float zz, float scale, int octaves, float persistance, float lacunarity, bool power ) {
-
-	if ( scale <= 0 ) scale = 0.0001f;
-	if ( octaves < 1 ) octaves = 1;
-	if ( persistance > 1 ) persistance = 1;
-	if ( persistance < 0 ) persistance = 0;
-	if ( lacunarity < 1 ) lacunarity = 1;
-
-	float amplitude = 1.0f;
-	float frequency = 1.0f;
-	float noiseValue = 0.0f;
-
-	for ( int i = 0; i < octaves; ++i ) {
-
-		float sampleX = xx / scale * frequency;
-		float sampleZ = zz / scale * frequency;
-
-		// float nv = pow(2.71828182845904523536, noise_2d(sampleX, sampleZ));
-		float nv = noise_2d(sampleX, sampleZ);
-
-		noiseValue += nv * amplitude;
-
-		amplitude *= persistance;
-		frequency *= lacunarity;
-
-	}
-
-	if ( power ) noiseValue = pow(2.71828182845904523536, noiseValue);
-
-	return noiseValue; 
+// Every stroke of edits can be undone with 'u'. A snapshot only copies the chunk table,
+// the chunks themselves are copied as the stroke writes to them.
+static std::vector<World_Snapshot> undo_snapshots;
 
+static void track_undo_snapshots() {
+	memory_track_cpu( &undo_snapshots, "undo snapshots", world_snapshot_bytes( undo_snapshots ) );
 }
 
-static void generate_world_mesh_layer ( int layer, bool occlude = false ) {
-	
-	world.generated_full_sb[layer] = !occlude;
-
-	glm::vec2 x_vector = glm::vec2(0.5f, -0.25f);
-	glm::vec2 z_vector = glm::vec2(-0.5f, -0.25f);
-	glm::vec2 y_vector = glm::vec2(0, -1);
-
-	int y = layer;
-	prepairTexturedSpriteBatchForPush( &world.tile_sb[y] ); 
-	for (int z = 0; z < World::SIZE_Z; ++z) {
-		for (int x = 0; x < World::SIZE_X; ++x) {
-
-			// This is testing to see if we can skip rendering this
-			// tile because it is obstructed by other tiles.
-			if ( occlude ) 
-				if ( x > 0 && world.tiles[y][z][x-1].type != AIR && !world.tiles[y][z][x-1].is_ramp ) 
-					if ( z > 0 && world.tiles[y][z-1][x].type != AIR && !world.tiles[y][z-1][x].is_ramp ) 
-						if ( y < World::SIZE_Y-1 && world.tiles[y+1][z][x].type != AIR )
-							continue;
-
-			glm::vec2 loc = (float)x*x_vector*32.0f + (float)z*z_vector*32.0f + (float)y*y_vector*16.0f;
-			glm::vec4 tex = glm::vec4(0, 0, 1.0f, 1.0f);
-
-			switch ( world.tiles[y][z][x].type ) {
-				case AIR: continue; break;
-				case DIRT: tex = glm::vec4(0, 0, 0.125f, 0.125f); break;
-				case DIRT_RAMP: {
-					switch ( world.tiles[y][z][x].direction ) {
-						case XP_ZP: tex = glm::vec4(0.625f, 0.0f, 0.750f, 0.125f); break;
-						case XN_ZN: tex = glm::vec4(0.875f, 0.125f, 1.000f, 0.250f); break;
-						case XP_ZN: tex = glm::vec4(0.750f, 0.125f, 0.875f, 0.250f); break;
-						case XN_ZP: tex = glm::vec4(0.625f, 0.125f, 0.750f, 0.250f); break;
-						
-						// case XP: tex = glm::vec4(0.125f, 0.500f, 0.250f, 0.625f); break;
-						// case ZP: tex = glm::vec4(0.250f, 0.500f, 0.375f, 0.625f); break;
-						// case ZN: tex = glm::vec4(0.375f, 0.500f, 0.500f, 0.625f); break;
-						// case XN: tex = glm::vec4(0.500f, 0.500f, 0.625f, 0.625f); break;
-						case XP: tex = glm::vec4(0.375f, 0.0f, 0.500f, 0.125f); break;
-						case ZP: tex = glm::vec4(0.500f, 0.0f, 0.625f, 0.125f); break;
-						case XN: tex = glm::vec4(0.875f, 0.0f, 1.000f, 0.125f); break;
-						case ZN: tex = glm::vec4(0.750f, 0.0f, 0.875f, 0.125f); break;
-						default: break;
-					}
-				} break;
-				case WOOD_RAMP: {
-					switch ( world.tiles[y][z][x].direction ) {
-						case XP: tex = glm::vec4(0.375f, 0.0f, 0.500f, 0.125f); break;
-						case ZP: tex = glm::vec4(0.500f, 0.0f, 0.625f, 0.125f); break;
-						case XN: tex = glm::vec4(0.875f, 0.0f, 1.000f, 0.125f); break;
-						case ZN: tex = glm::vec4(0.750f, 0.0f, 0.875f, 0.125f); break;
-						default: break;
-					}
-				} break;
-				case STONE: tex = glm::vec4(0, 0.250f, 0.125f, 0.375f); break;
-				case WOOD: tex = glm::vec4(0, 0.500f, 0.125f, 0.625f); break;
-				case LAVA: tex = glm::vec4(0.000f, 0.750f, 0.125f, 0.875f); break;
-				default: tex = glm::vec4(0, 0, 1.0f, 1.0f); break;
-			}
-			
-			auto is_empty = [&]( int yy, int zz, int xx ) -> bool {
-				if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-					if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx].type == AIR; }
-					else { return true; }
-				} else { return true; }
-			};
-
-			auto is_ramp = [&]( int yy, int zz, int xx ) -> bool {
-				if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-					if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx].is_ramp; }
-					else { return false; }
-				} else { return false; }
-			};
-
-			auto is_surrounded = [&]( int yy, int zz, int xx ) -> bool {
-				if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-					if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx].type == AIR || world.tiles[yy][zz][xx].type == LAVA; }
-					else { return false; }
-				} else { return false; }
-			};
-
-			if ( !is_surrounded(y+1, z, x) && !is_surrounded(y-1, z, x) ) {
-				if ( !is_surrounded(y, z+1, x) && !is_ramp(y, z+1, x) ) {
-					if ( !is_surrounded(y, z-1, x) && !is_ramp(y, z-1, x) ) {
-						if ( !is_surrounded(y, z, x+1) && !is_ramp(y, z, x+1) ) {
-							if ( !is_surrounded(y, z, x-1) && !is_ramp(y, z, x-1) ) {
-								tex = glm::vec4( 0.875f, 0.875f, 1.0f, 1.0f );
-							}
-						}
-					}
-				}
-			}
-
-			pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), tex, 1.0f );
-
-			if ( world.tiles[y][z][x].is_full ) {
-				if ( is_empty(y, z, x+1) || is_ramp(y, z, x+1) ) { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.250f ,0.0f, 0.375f, 0.125f), 1.0f ); }
-				if ( is_empty(y, z+1, x) || is_ramp(y, z+1, x) )  { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.125f, 0.0f, 0.250f, 0.125f), 1.0f ); }
-				if ( is_empty(y-1, z, x) ) { 
-					pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.625f, 0.375f, 0.750f, 0.500f), 1.0f );
-					pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.750f, 0.375f, 0.875f, 0.500f), 1.0f );
-				}
-			}
+static Input_Recording input_recording;
+static Input_Frame current_input;
+static bool input_replay_done = false;
+static float fixed_delta_time = 0; // 0 runs on the clock.
+static glm::vec2 raw_mouse_position;
 
-			if ( world.tiles[y][z][x].is_ramp ) {
-				if 		( world.tiles[y][z][x].direction == XP_ZP ) { }
-				else if ( world.tiles[y][z][x].direction == XN_ZN ) { }
-				else if ( world.tiles[y][z][x].direction == XP_ZN ) { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.375f, 0.375f, 0.500f, 0.500f), 1.0f ); }
-				else if ( world.tiles[y][z][x].direction == XN_ZP ) { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.500f, 0.375f, 0.625f, 0.500f), 1.0f ); }
-				else if ( world.tiles[y][z][x].direction == XP && is_empty(y, z+1, x) ) { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.375f, 0.125f, 0.500f, 0.250f), 1.0f ); } 
-				else if ( world.tiles[y][z][x].direction == ZP && is_empty(y, z, x+1) ) { pushToTexturedSpriteBatch( &world.tile_sb[y], glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.500f, 0.125f, 0.625f, 0.250f), 1.0f ); }
-				else if ( world.tiles[y][z][x].direction == XN && is_empty(y, z-1, x) ) { }
-				else if ( world.tiles[y][z][x].direction == ZN && is_empty(y, z, x-1) ) { }
-			}
-
-		}
-	}
-	buildTexturedSpriteBatch( &world.tile_sb[y], world.shaderID );
-}
-
-static void generate_world_mesh () {
-
-	for (int y = 0; y < World::SIZE_Y; ++y) {
-		generate_world_mesh_layer(y, true);
-	}
-
-}
-
-void generate_world() {
-
-	for (int y = 0; y < World::SIZE_Y; ++y) {
-		for (int z = 0; z < World::SIZE_Z; ++z) {
-			for (int x = 0; x < World::SIZE_X; ++x) {
-				
-				world.tiles[y][z][x].type = AIR;
-
-				int height = (int)(generateHeightmap( x, World::SIZE_Z-z, 350, 4, 0.5f, 2.5f, 1 ) * 25.0f ) + 64;
-				if ( height > y ) {
-					world.tiles[y][z][x].type = STONE;
-					world.tiles[y][z][x].is_full = true;
-				}
-				else if ( height == y ) {
-					world.tiles[y][z][x].type = DIRT;
-					world.tiles[y][z][x].is_full = true;
-				}
-
-				float sim_val = simplex_noise( 3, x/32.0f, y/32.0f, z/32.0f );
-				// if ( y > 100 ) sim_val += (y-128);
-				if ( y > 32 ) sim_val = 1000;
-				if ( sim_val < 2.1f ) {
-					world.tiles[y][z][x].type = LAVA;
-					world.tiles[y][z][x].is_full = false;
-				}
-
-			}
-		}
-	}
-
-	auto is_empty = [&]( int yy, int zz, int xx ) -> bool {
-		if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-			if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx].type == AIR; }
-			else { return true; }
-		} else { return true; }
-	};
-
-	auto is_ramp = [&]( int yy, int zz, int xx ) -> bool {
-		if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-			if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx].is_ramp; }
-			else { return false; }
-		} else { return false; }
-	};
-
-	auto get_tile = [&]( int yy, int zz, int xx ) -> Tile {
-		if ( zz < World::SIZE_Z && xx < World::SIZE_X && yy < World::SIZE_Y ) {
-			if ( zz >= 0 && xx >= 0 && yy >= 0) { return world.tiles[yy][zz][xx]; }
-			else { return {}; }
-		} else { return {}; }
-	};
+//////////////////////
+/////////////
+/////////////////
 
-	for (int y = 0; y < World::SIZE_Y; ++y) {
-		for (int z = 0; z < World::SIZE_Z; ++z) {
-			for (int x = 0; x < World::SIZE_X; ++x) {
-
-				if ( is_empty(y, z, x) && is_empty(y+1, z, x) && !is_empty(y-1, z, x) && !is_ramp(y-1, z, x) ) {
-
-					if ( get_tile(y, z, x+1).type == DIRT || get_tile(y, z, x-1).type == DIRT || get_tile(y, z+1, x).type == DIRT || get_tile(y, z-1, x).type == DIRT) {
-						
-						world.tiles[y][z][x].type = DIRT_RAMP;
-						world.tiles[y][z][x].is_ramp = true;
-						
-						if ( get_tile(y, z, x+1).is_full && get_tile(y, z+1, x).is_full && get_tile(y, z, x-1).is_full ) 		{ world.tiles[y][z][x].direction = ZP; }
-						else if ( get_tile(y, z, x+1).is_full && get_tile(y, z+1, x).is_full && get_tile(y, z-1, x).is_full ) 	{ world.tiles[y][z][x].direction = XP; }
-						else if ( get_tile(y, z, x-1).is_full && get_tile(y, z+1, x).is_full && get_tile(y, z-1, x).is_full ) 	{ world.tiles[y][z][x].direction = XN; }
-						else if ( get_tile(y, z, x+1).is_full && get_tile(y, z-1, x).is_full && get_tile(y, z, x-1).is_full ) 	{ world.tiles[y][z][x].direction = ZN; }
-						else if ( get_tile(y, z, x+1).is_full && get_tile(y, z+1, x).is_full) 									{ world.tiles[y][z][x].direction = XP_ZP; }
-						else if ( get_tile(y, z, x-1).is_full && get_tile(y, z-1, x).is_full) 									{ world.tiles[y][z][x].direction = XN_ZN; }
-						else if ( get_tile(y, z, x-1).is_full && get_tile(y, z+1, x).is_full) 									{ world.tiles[y][z][x].direction = XN_ZP; }
-						else if ( get_tile(y, z, x+1).is_full && get_tile(y, z-1, x).is_full) 									{ world.tiles[y][z][x].direction = XP_ZN; }
-						else if ( get_tile(y, z, x+1).is_full ) 																{ world.tiles[y][z][x].direction = XP; }
-						else if ( get_tile(y, z+1, x).is_full ) 																{ world.tiles[y][z][x].direction = ZP; }
-						else if ( get_tile(y, z, x-1).is_full ) 																{ world.tiles[y][z][x].direction = XN; }
-						else if ( get_tile(y, z-1, x).is_full ) 																{ world.tiles[y][z][x].direction = ZN; }
-					}
-				}
+void resize_view( float ww, float wh, float glvw, float glvh );
 
-			}
-		}
+// Remeshes the visible layers that edits have made dirty, the top one without occlusion.
+// Dirty layers above the cutoff are left until the cutoff moves up to them.
+static void remesh_dirty_layers() {
+	for ( int y = 0; y < world_cutoff_height; ++y ) {
+		if ( world_layer_dirty( y ) ) generate_world_mesh_layer( y, y != world_cutoff_height-1 );
 	}
-
 }
 
 void init_game() {
+	TRACE_SCOPE( "init_game" );
+	STARTUP_PHASE( "init_game" );
 
 	if ( dynamic_resolution ) { render_dimensions = window_size; }
 
+	startup_begin_phase( "freetype" );
 	FT_Init_FreeType( &freeType );
+	startup_end_phase();
 	
 	glEnable( GL_DEPTH_TEST );
 
@@ -378,12 +133,10 @@ void init_game() {
 	viewMatrix = glm::translate( glm::mat4(1), -cameraPosition ); 
 	projectionMatrix = glm::ortho( 0.0f, render_dimensions.x, render_dimensions.y, 0.0f, 0.1f, 1000.0f);
 
-	game_cameraPosition = glm::vec3(0, -(World::SIZE_X+2)*10, 1500);
-	game_camera_scale = 100.0f;
-	game_viewMatrix = glm::translate( glm::scale(glm::mat4(1), glm::vec3(1.0f/game_camera_scale, 1.0f/game_camera_scale, 1)), -game_cameraPosition ); 
-	glm::vec2 aspect = glm::vec2( (float)render_dimensions.x/render_dimensions.y*10, (float)render_dimensions.x/render_dimensions.y*render_dimensions.y/render_dimensions.x*10 );
-	game_projectionMatrix = glm::ortho( -aspect.x/2, aspect.x/2, aspect.y/2, -aspect.y/2, 0.1f, 2000.0f);
+	// The platform layer can create a world of another size before calling init_game().
+	if ( world.chunks.empty() ) create_world( WORLD_DEFAULT_SIZE_X, WORLD_DEFAULT_SIZE_Y, WORLD_DEFAULT_SIZE_Z );
 
+	startup_begin_phase( "debug text" );
 	debug_text_shader_id = LoadShaders( "res/shaders/textshader_vert.glsl", "res/shaders/textshader_frag.glsl" );
 	debug_pgt.fontsize = 32 ;
 	create_packed_glyph_texture( debug_pgt, "res/Menlo-Regular.ttf", freeType );
@@ -391,9 +144,13 @@ void init_game() {
 	debug_text_mesh.transform = glm::translate( glm::mat4(1), debug_text_mesh.position );	
 	debug_text_mesh.fontsize = 16;
 	create_text_mesh( "dt: ", debug_text_mesh, debug_pgt, debug_text_shader_id );
+	startup_end_phase();
 
+	startup_begin_phase( "main menu" );
 	main_menu.init();
+	startup_end_phase();
 
+	startup_begin_phase( "world assets" );
 	world.shaderID = LoadShaders( "res/shaders/spritebatchshader_texture_vert.glsl", "res/shaders/spritebatchshader_texture_frag.glsl" );
 	LoadTexture( &world.texID, "res/sprites/TileMap.png" );
 	LoadTexture( &half_height_texture, "res/sprites/TileMapHalfHeight.png" );
@@ -401,14 +158,76 @@ void init_game() {
 
 	cursor_sb.shaderID = LoadShaders( "res/shaders/spritebatchshader_texture_vert.glsl", "res/shaders/spritebatchshader_texture_frag.glsl" );
 	LoadTexture( &cursor_sb.texID, "res/sprites/TileMap.png" );
+	memory_name( &cursor_sb, "cursor" );
+	startup_end_phase();
+
+	// A saved world replaces the one created above, size and all.
+	bool loaded = false;
+	bool keep_world_file = false;
+	if ( world_file ) {
+		startup_begin_phase( "load_world_file" );
+		loaded = load_world_file( world_file );
+		startup_end_phase();
+		// A file that is there but didn't load ( another version, damaged ) is someone's world, never save over it.
+		keep_world_file = !loaded && world_file_exists( world_file );
+		if ( keep_world_file ) printf( "Generating a world instead of %s, which is left as it is.\n", world_file );
+	} else if ( world_cache ) {
+		startup_begin_phase( "load_cached_world" );
+		loaded = load_cached_world( world_cache );
+		startup_end_phase();
+	}
+	if ( !loaded ) {
+		startup_begin_phase( "generate_world" );
+		generate_world();
+		startup_end_phase();
+		if ( world_file && !keep_world_file ) {
+			startup_begin_phase( "save_world_file" );
+			save_world_file( world_file );
+			startup_end_phase();
+		} else if ( !world_file && world_cache ) {
+			startup_begin_phase( "save_cached_world" );
+			save_cached_world( world_cache );
+			startup_end_phase();
+		}
+	}
+	world_cutoff_height = world.size_y;
+
+	game_cameraPosition = glm::vec3(0, -(world.size_x+2)*10, 1500);
+	game_camera_scale = 100.0f;
+	game_viewMatrix = glm::translate( glm::scale(glm::mat4(1), glm::vec3(1.0f/game_camera_scale, 1.0f/game_camera_scale, 1)), -game_cameraPosition ); 
+	glm::vec2 aspect = glm::vec2( (float)render_dimensions.x/render_dimensions.y*10, (float)render_dimensions.x/render_dimensions.y*render_dimensions.y/render_dimensions.x*10 );
+	game_projectionMatrix = glm::ortho( -aspect.x/2, aspect.x/2, aspect.y/2, -aspect.y/2, 0.1f, 2000.0f);
 
-	generate_world();
+	startup_begin_phase( "generate_world_mesh" );
 	generate_world_mesh();
+	startup_end_phase();
 
 }
 
 void input_game() {
 
+	profiler_begin_frame();
+	PROFILE_SCOPE( "input_game" );
+
+	// When replaying, the recorded input replaces whatever the platform layer set.
+	if ( input_recording.replaying ) {
+		if ( read_input_frame( input_recording, current_input ) ) {
+			for ( int k = 0; k < 256; ++k ) down_keys[k] = (current_input.keys[k/8] >> (k%8)) & 1;
+			set_mouse_position( current_input.mouse_x, current_input.mouse_y );
+			set_mouse_state( current_input.mouse_state );
+			set_mouse_scroll_value( current_input.mouse_scroll );
+		} else {
+			input_replay_done = true;
+		}
+	} else if ( input_recording.file ) {
+		memset( current_input.keys, 0, sizeof(current_input.keys) );
+		for ( int k = 0; k < 256; ++k ) if ( down_keys[k] ) current_input.keys[k/8] |= (uint8_t)( 1 << (k%8) );
+		current_input.mouse_x = raw_mouse_position.x;
+		current_input.mouse_y = raw_mouse_position.y;
+		current_input.mouse_state = mouse_state;
+		current_input.mouse_scroll = mouse_scroll;
+	}
+
 	game_camera_scale += mouse_scroll * delta_time;
 	if ( game_camera_scale < 0.01f ) game_camera_scale = 0.01f;
 	game_viewMatrix = glm::translate( glm::scale(glm::mat4(1), glm::vec3(1.0f/game_camera_scale, 1.0f/game_camera_scale, 1)), -game_cameraPosition ); 
@@ -515,68 +334,64 @@ void input_game() {
 		if ( block_to_place == 0 ) cursor_disable_depth = false;
 		else cursor_disable_depth = true;
 
-		if ( mouse_state == 1 ) {
-
-			if ( mouse_grid_x-world_cutoff_height+1 < World::SIZE_X && mouse_grid_z-world_cutoff_height+1 < World::SIZE_Z && mouse_grid_x-world_cutoff_height+1 >= 0 && mouse_grid_z-world_cutoff_height+1 >= 0 ) {
-				if ( block_to_place == 0 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = AIR;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = NONE;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = false;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = false;
-				} else if ( block_to_place == 1 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = WOOD;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = NONE;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = true;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = false;
-				} 
-
-
-				else if ( block_to_place == 2 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = WOOD_RAMP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = XP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = false;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = true;
-				} else if ( block_to_place == 3 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = WOOD_RAMP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = ZP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = false;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = true;
-				} else if ( block_to_place == 4 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = WOOD_RAMP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = ZN;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = false;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = true;
-				} else if ( block_to_place == 5 ) {
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].type = WOOD_RAMP;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].direction = XN;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_full = false;
-					world.tiles[world_cutoff_height-1][(int)mouse_grid_z-world_cutoff_height+1][(int)mouse_grid_x-world_cutoff_height+1].is_ramp = true;
-				}
-				
-				generate_world_mesh_layer( world_cutoff_height-1 );
-				// if ( !world.generated_full_sb[world_cutoff_height-2] ){
-					generate_world_mesh_layer( world_cutoff_height-2, true );
-				// } 
+		static bool u_pressed = false;
+		if ( down_keys['u'] ) {
+			if ( !u_pressed && !undo_snapshots.empty() ) {
+				restore_world_snapshot( undo_snapshots.back() );
+				release_world_snapshot( undo_snapshots.back() );
+				undo_snapshots.pop_back();
+				track_undo_snapshots();
+				remesh_dirty_layers();
 			}
+			u_pressed = true;
+		} else {
+			u_pressed = false;
+		}
 
+		// What 'n' cycles through, and the sprite the cursor shows for each.
+		const Tile placeable_tiles[] = { make_tile( AIR ), make_tile( WOOD ), make_tile( WOOD_RAMP, XP ), make_tile( WOOD_RAMP, ZP ), make_tile( WOOD_RAMP, ZN ), make_tile( WOOD_RAMP, XN ) };
+		const glm::vec4 placeable_texcoords[] = {
+			glm::vec4(0.250f, 0.125f, 0.375f, 0.250f), glm::vec4(0, 0.500f, 0.125f, 0.625f), glm::vec4(0.125f, 0.500f, 0.250f, 0.625f),
+			glm::vec4(0.250f, 0.500f, 0.375f, 0.625f), glm::vec4(0.375f, 0.500f, 0.500f, 0.625f), glm::vec4(0.500f, 0.500f, 0.625f, 0.625f),
+		};
+
+		// Edits go on the top visible layer, and only remesh the layers they changed.
+		int place_x = (int)mouse_grid_x - world_cutoff_height + 1;
+		int place_z = (int)mouse_grid_z - world_cutoff_height + 1;
+		// A stroke is snapshotted by its first edit that changes a tile, so clicks that change nothing cost nothing.
+		// Once the stroke ends its chunks are re-encoded, so a chunk that lost tiles gets a smaller palette.
+		static bool stroke_snapshotted = false;
+		if ( mouse_state != 1 && stroke_snapshotted ) {
+			compact_world();
+			track_undo_snapshots();
+			stroke_snapshotted = false;
+		}
+		if ( mouse_state == 1 && place_x >= 0 && place_z >= 0 && place_x < world.size_x && place_z < world.size_z ) {
+			Tile tile = placeable_tiles[block_to_place];
+			if ( get_world_tile( world_cutoff_height-1, place_z, place_x ).bits != tile.bits ) {
+				if ( !stroke_snapshotted ) {
+					if ( undo_snapshots.size() == GAME_UNDO_LEVELS ) {
+						release_world_snapshot( undo_snapshots.front() );
+						undo_snapshots.erase( undo_snapshots.begin() );
+					}
+					undo_snapshots.push_back( snapshot_world() );
+					stroke_snapshotted = true;
+				}
+				set_world_tile( world_cutoff_height-1, place_z, place_x, tile );
+				remesh_dirty_layers();
+				track_undo_snapshots();
+			}
 		}
 
 		prepairTexturedSpriteBatchForPush( &cursor_sb ); 
-			if ( block_to_place == 0 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.250f ,0.125f, 0.375f, 0.250f), 1.0f );
-			if ( block_to_place == 1 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0, 0.500f, 0.125f, 0.625f), 1.0f );
-
-			if ( block_to_place == 2 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.125, 0.500f, 0.250f, 0.625f), 1.0f );
-			if ( block_to_place == 3 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.250, 0.500f, 0.375f, 0.625f), 1.0f );
-			if ( block_to_place == 4 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.375, 0.500f, 0.500f, 0.625f), 1.0f );
-			if ( block_to_place == 5 ) pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), glm::vec4(0.500, 0.500f, 0.625f, 0.625f), 1.0f );
+			pushToTexturedSpriteBatch( &cursor_sb, glm::vec3(gPos.x, gPos.y, -(mouse_grid_x-world_cutoff_height+1 + mouse_grid_z-world_cutoff_height+1) + (world_cutoff_height-1)*2 + 0.5f ), glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), placeable_texcoords[block_to_place], 1.0f );
 		buildTexturedSpriteBatch( &cursor_sb, cursor_sb.shaderID );
 	}
 
 	static bool q_pressed = false;
 	if ( down_keys['q'] ) {
 		// if ( !q_pressed ) {
-			world_cutoff_height--;
-			if ( world_cutoff_height < 1 ) world_cutoff_height = 1;
+			world_cutoff_height = clamp_cutoff_height( world_cutoff_height-1 );
 			generate_world_mesh_layer( world_cutoff_height-1 );
 		// }
 		q_pressed = true;
@@ -587,8 +402,7 @@ void input_game() {
 	static bool e_pressed = false;
 	if ( down_keys['e'] ) {
 		// if ( !e_pressed ) {
-			world_cutoff_height++;
-			if ( world_cutoff_height > World::SIZE_Y-1 ) world_cutoff_height = World::SIZE_Y-1;
+			world_cutoff_height = clamp_cutoff_height( world_cutoff_height+1 );
 			generate_world_mesh_layer( world_cutoff_height-1 );
 			generate_world_mesh_layer( world_cutoff_height-2, true );
 		// }
@@ -600,8 +414,7 @@ void input_game() {
 	static bool i_pressed = false;
 	if ( down_keys['i'] ) {
 		if ( !i_pressed ) {
-			world_cutoff_height--;
-			if ( world_cutoff_height < 1 ) world_cutoff_height = 1;
+			world_cutoff_height = clamp_cutoff_height( world_cutoff_height-1 );
 			generate_world_mesh_layer( world_cutoff_height-1 );
 			game_cameraPosition += glm::vec3(0, 16, 0);
 			game_viewMatrix = glm::translate( glm::scale(glm::mat4(1), glm::vec3(1.0f/game_camera_scale, 1.0f/game_camera_scale, 1)), -game_cameraPosition );
@@ -614,8 +427,7 @@ void input_game() {
 	static bool p_pressed = false;
 	if ( down_keys['p'] ) {
 		if ( !p_pressed ) {
-			world_cutoff_height++;
-			if ( world_cutoff_height > World::SIZE_Y-1 ) world_cutoff_height = World::SIZE_Y-1;
+			world_cutoff_height = clamp_cutoff_height( world_cutoff_height+1 );
 			generate_world_mesh_layer( world_cutoff_height-1 );
 			generate_world_mesh_layer( world_cutoff_height-2, true );
 			game_cameraPosition += glm::vec3(0, -16, 0);
@@ -640,15 +452,23 @@ void input_game() {
 }
 
 void update_game() {
-	static mach_timebase_info_data_t info;
-	if ( mach_timebase_info (&info) != KERN_SUCCESS ) { printf ("mach_timebase_info failed\n"); }
+	PROFILE_SCOPE( "update_game" );
+
 	static uint64_t startTime = 0;
-	uint64_t endTime = mach_absolute_time();
-	uint64_t nanosecs = (endTime - startTime) * info.numer / info.denom;
-	startTime = mach_absolute_time();
+	uint64_t endTime = get_time_ns();
+	uint64_t nanosecs = endTime - startTime;
+	startTime = get_time_ns();
 
 	delta_time = 1.0f/1000.0f*(float)nanosecs/1000000;
 
+	// A replay runs with the recorded time steps instead of the clock, or with the fixed
+	// one when there is one, which makes it independent of how fast the recording ran.
+	if ( fixed_delta_time > 0 ) delta_time = fixed_delta_time;
+	else if ( input_recording.replaying && !input_replay_done ) delta_time = current_input.delta_time;
+	if ( input_recording.file && !input_recording.replaying ) {
+		current_input.delta_time = delta_time;
+		write_input_frame( input_recording, current_input );
+	}
 
 	main_menu.update();
 
@@ -661,21 +481,82 @@ void update_game() {
 	float mouse_grid_x = -ceil((-gmp_x / 32.0f) + (gmp_y / 16.0f));
 	glm::vec2 gPos = mouse_grid_x*x_vector*32.0f + mouse_grid_z*z_vector*32.0f; //* (x_vector*32.0f) * (z_vector*32.0f) * (y_vector*16.0f);
 
+	// The column under the cursor, at the cutoff height.
+	std::string column_text = "-";
+	int column_x = (int)mouse_grid_x - world_cutoff_height + 1;
+	int column_z = (int)mouse_grid_z - world_cutoff_height + 1;
+	if ( column_x >= 0 && column_z >= 0 && column_x < world.size_x && column_z < world.size_z ) {
+		const Column_Run* runs;
+		column_text = "top " + std::to_string( column_top_solid( column_z, column_x, world_cutoff_height ) ) +
+			( world.heightmap.empty() ? "" : ", generated " + std::to_string( get_world_height( column_z, column_x ) ) ) +
+			", visible " + std::to_string( column_first_visible( column_z, column_x, world_cutoff_height ) ) +
+			", runs " + std::to_string( get_world_column( column_z, column_x, &runs ) );
+	}
+
 	create_text_mesh( 
 		(
-			"dt: " + std::to_string(delta_time*1000.0f) + 
+			profiler_report() +
+			"\n" + gpu_timer_report() +
+			"\n" + memory_report( 5 ) +
 			"\nrd: " + std::to_string((int)render_dimensions.x) + "x" + std::to_string((int)render_dimensions.y) +
 			"\nwd: " + std::to_string((int)window_size.x) + "x" + std::to_string((int)window_size.y) +
 			"\nvd: " + std::to_string((int)gl_viewport_size.x) + "x" + std::to_string((int)gl_viewport_size.y) +
 			"\n" + std::to_string(gPos.x) + ", " + std::to_string(gPos.y) +
 			"\n" + std::to_string(mouse_grid_z) + ", " + std::to_string(mouse_grid_x) + 
 			"\nch: " + std::to_string(world_cutoff_height) +
+			"\ncol: " + column_text +
 			"\nScroll: " + std::to_string(game_camera_scale)
 		).c_str(), debug_text_mesh, debug_pgt, debug_text_shader_id );
 }
 
-void render_game() {
+void set_game_view( float camera_x, float camera_y, float camera_scale, int cutoff_height ) {
+	main_menu.main_menu_enabled = false;
+
+	game_cameraPosition = glm::vec3( camera_x, camera_y, game_cameraPosition.z );
+	game_camera_scale = camera_scale;
+	game_viewMatrix = glm::translate( glm::scale(glm::mat4(1), glm::vec3(1.0f/game_camera_scale, 1.0f/game_camera_scale, 1)), -game_cameraPosition ); 
+
+	// The top visible layer is the only one meshed without occlusion.
+	cutoff_height = clamp_cutoff_height( cutoff_height );
+	if ( cutoff_height != world_cutoff_height ) {
+		generate_world_mesh_layer( world_cutoff_height-1, true );
+		world_cutoff_height = cutoff_height;
+		generate_world_mesh_layer( world_cutoff_height-1 );
+	}
+	remesh_dirty_layers();
+}
+
+void render_game_world() {
+	glUseProgram( world.shaderID );
+
+		setUniformMat4( world.shaderID, "view", game_viewMatrix );
+		setUniformMat4( world.shaderID, "projection", game_projectionMatrix );
+		
+		// for (int y = 0; y < world_cutoff_height; ++y) {
+		// 	setUniform4f( world.shaderID, "tintColor", glm::vec4( glm::vec3( 0.5f + 0.5f*(1.0f/World::SIZE_Y*(y+1)+1.0f/World::SIZE_Y*(World::SIZE_Y-world_cutoff_height))  ), 1.0f) );
+		// 	unsigned int used_texture = world.texID;
+		// 	if ( render_half_height && y == world_cutoff_height-1 ) used_texture = half_height_texture;
+		// 	renderTexturedSpriteBatch( &world.tile_sb[y], world.shaderID, used_texture );
+		// }
+
+		for (int y = 0; y < world_cutoff_height; ++y) {
+			
+			float tint_value = 0.7f;
+			if ( y+20 > world_cutoff_height ) tint_value = 0.7f + 0.3f/20*(20 - (world_cutoff_height - y));
+
+			setUniform4f( world.shaderID, "tintColor", glm::vec4( glm::vec3( tint_value  ), 1.0f) );
+			
+
+			unsigned int used_texture = world.texID;
+			if ( render_half_height && y == world_cutoff_height-1 ) used_texture = half_height_texture;
+			renderTexturedSpriteBatch( &world.tile_sb[y], world.shaderID, used_texture );
+		}
+
+}
 
+void render_game() {
+	PROFILE_SCOPE( "render_game" );
+	gpu_timer_begin_frame();
 	
 	
 	static unsigned int fbo = 0;
@@ -702,6 +583,7 @@ void render_game() {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, renderedTexture, 0);
+		memory_track( &renderedTexture, "render target", 0, (size_t)render_dimensions.x * render_dimensions.y * 4 );
 
 		if ( depthTexture == 0 ) glGenTextures(1, &depthTexture);
 		glBindTexture(GL_TEXTURE_2D, depthTexture);
@@ -709,6 +591,7 @@ void render_game() {
 		// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		// glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+		memory_track( &depthTexture, "render target depth", 0, (size_t)render_dimensions.x * render_dimensions.y * 4 );
 	}
 
 
@@ -720,33 +603,15 @@ void render_game() {
 	glClearColor(25/255.0f, 25/255.0f, 25/255.0f, 1);
 	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
 
-	glUseProgram( world.shaderID );
-
-		setUniformMat4( world.shaderID, "view", game_viewMatrix );
-		setUniformMat4( world.shaderID, "projection", game_projectionMatrix );
-		
-		// for (int y = 0; y < world_cutoff_height; ++y) {
-		// 	setUniform4f( world.shaderID, "tintColor", glm::vec4( glm::vec3( 0.5f + 0.5f*(1.0f/World::SIZE_Y*(y+1)+1.0f/World::SIZE_Y*(World::SIZE_Y-world_cutoff_height))  ), 1.0f) );
-		// 	unsigned int used_texture = world.texID;
-		// 	if ( render_half_height && y == world_cutoff_height-1 ) used_texture = half_height_texture;
-		// 	renderTexturedSpriteBatch( &world.tile_sb[y], world.shaderID, used_texture );
-		// }
-
-		for (int y = 0; y < world_cutoff_height; ++y) {
-			
-			float tint_value = 0.7f;
-			if ( y+20 > world_cutoff_height ) tint_value = 0.7f + 0.3f/20*(20 - (world_cutoff_height - y));
-
-			setUniform4f( world.shaderID, "tintColor", glm::vec4( glm::vec3( tint_value  ), 1.0f) );
-			
-
-			unsigned int used_texture = world.texID;
-			if ( render_half_height && y == world_cutoff_height-1 ) used_texture = half_height_texture;
-			renderTexturedSpriteBatch( &world.tile_sb[y], world.shaderID, used_texture );
-		}
+	{
+		GPU_TIMER_SCOPE( "world layers" );
+		render_game_world();
+	}
 
-	if ( !cursor_disable_depth ) glClear( GL_DEPTH_BUFFER_BIT );
-	glUseProgram( cursor_sb.shaderID );
+	{
+		GPU_TIMER_SCOPE( "cursor" );
+		if ( !cursor_disable_depth ) glClear( GL_DEPTH_BUFFER_BIT );
+		glUseProgram( cursor_sb.shaderID );
 
 		setUniformMat4( cursor_sb.shaderID, "view", game_viewMatrix );
 		setUniformMat4( cursor_sb.shaderID, "projection", game_projectionMatrix );
@@ -755,19 +620,26 @@ void render_game() {
 		unsigned int used_texture = cursor_sb.texID;
 		if ( render_half_height ) used_texture = half_height_texture;
 		renderTexturedSpriteBatch( &cursor_sb, cursor_sb.shaderID, used_texture );
+	}
 
-	glClear( GL_DEPTH_BUFFER_BIT );
-	main_menu.render();
+	{
+		GPU_TIMER_SCOPE( "main menu" );
+		glClear( GL_DEPTH_BUFFER_BIT );
+		main_menu.render();
+	}
+
+	{
+		GPU_TIMER_SCOPE( "debug text" );
+		glClear( GL_DEPTH_BUFFER_BIT );
+		glUseProgram( debug_text_shader_id );
 
-	glClear( GL_DEPTH_BUFFER_BIT );
-	glUseProgram( debug_text_shader_id );
-		
 		setUniformMat4( debug_text_shader_id, "view", viewMatrix );
 		setUniformMat4( debug_text_shader_id, "projection", projectionMatrix );
 		setUniform4f( debug_text_shader_id, "overlayColor", glm::vec4(1.0f) );
 		render_text_mesh( debug_text_mesh, debug_text_shader_id );
 
-	glUseProgram( 0 );
+		glUseProgram( 0 );
+	}
 
 
 
@@ -784,6 +656,7 @@ void render_game() {
 		else scale_factor = gl_viewport_size.x / render_dimensions.x;
 
 		// glViewport(0, 0, 640, 480);
+		GPU_TIMER_SCOPE( "blit" );
 		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
 		glBlitFramebuffer(0, 0, render_dimensions.x, render_dimensions.y, (gl_viewport_size.x-render_dimensions.x*scale_factor)/2, (gl_viewport_size.y-render_dimensions.y*scale_factor)/2, render_dimensions.x*scale_factor + (gl_viewport_size.x-render_dimensions.x*scale_factor)/2, render_dimensions.y*scale_factor + (gl_viewport_size.y-render_dimensions.y*scale_factor)/2, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 	}
@@ -798,6 +671,7 @@ void render_game() {
 
 
 void set_mouse_position( float x, float y ) {
+	raw_mouse_position = glm::vec2( x, y );
 	mouse_position = glm::vec2( x, window_size.y-y );
 	if ( !dynamic_resolution ) {
 		float scale_factor = 1;
@@ -809,6 +683,40 @@ void set_mouse_position( float x, float y ) {
 	}
 }
 
+void set_world_file( const char* filename ) {
+	world_file = filename;
+}
+
+void set_world_cache( const char* directory ) {
+	world_cache = directory;
+}
+
+bool start_input_recording( const char* filename ) {
+	return open_input_recording( input_recording, filename, window_size.x, window_size.y );
+}
+
+bool start_input_replay( const char* filename ) {
+	input_replay_done = false;
+	return open_input_replay( input_recording, filename );
+}
+
+void get_input_replay_window_size( float* width, float* height ) {
+	*width = input_recording.window_width;
+	*height = input_recording.window_height;
+}
+
+void set_fixed_delta_time( float seconds ) {
+	fixed_delta_time = seconds > 0 ? seconds : 0;
+}
+
+bool input_replay_finished() {
+	return input_replay_done;
+}
+
+void stop_input_recording() {
+	close_input_recording( input_recording );
+}
+
 void set_mouse_state( unsigned int state ) {
 	mouse_state = state;
 }
@@ -7,6 +7,29 @@ void set_mouse_position( float x, float y );
 void set_mouse_state( unsigned int state );
 void set_mouse_scroll_value( float scroll_value );
 
+// Input recording and replay ( see replay.hpp ).
+// While replaying, input_game() ignores the platform's input and update_game() uses the recorded delta time.
+bool start_input_recording( const char* filename );
+bool start_input_replay( const char* filename );
+void get_input_replay_window_size( float* width, float* height );
+bool input_replay_finished();
+// Steps every frame by this many seconds instead of the clock or the recorded time steps,
+// so a replay does the same whatever machine it was recorded on. 0 turns it off.
+void set_fixed_delta_time( float seconds );
+void stop_input_recording();
+
+// Scripted views for the regression suite ( see regress.hpp ).
+// set_game_view() leaves the main menu and remeshes the layers the cutoff change affects.
+void set_game_view( float camera_x, float camera_y, float camera_scale, int cutoff_height );
+void render_game_world(); // Only the world layers, into whatever framebuffer is bound.
+
+// init_game() loads the world from this file ( see worldfile.hpp ) instead of generating it.
+// If the file can't be loaded, the world is generated and saved to it for the next start.
+void set_world_file( const char* filename );
+// Without a world file, the world is loaded from the cache in this directory and saved there once generated.
+// Starts as WORLD_CACHE_DIRECTORY, null turns the cache off.
+void set_world_cache( const char* directory );
+
 // void move_game_camera( float x, float y );
 
 void init_game();
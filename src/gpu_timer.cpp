@@ -0,0 +1,149 @@
+//
+//  gpu_timer.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <string.h>
+#include <stdio.h>
+#include <string>
+
+#include "profiler.hpp"
+#include "gpu_timer.hpp"
+
+struct Gpu_Timer_Frame {
+	bool pending = false;
+	int pass_count = 0;
+	const char* names[ GPU_TIMER_MAX_PASSES ];
+	unsigned int queries[ GPU_TIMER_MAX_PASSES*2 ]; // A begin and end timestamp per pass.
+};
+
+// The per pass history uses the profiler's ring size so the percentiles line up.
+// Pass 0 is the whole frame as seen by the GPU. A pass only gets a sample for
+// the frames it was in, so one first seen late isn't averaged with zeros.
+struct Gpu_Timer_Pass {
+	const char* name;
+	uint64_t history[ PROFILER_HISTORY_FRAMES ];
+	int history_index;
+	int history_count;
+};
+
+static Gpu_Timer_Frame frames[ GPU_TIMER_LATENCY ];
+static int current_frame = -1;
+static bool pass_open = false;
+
+static Gpu_Timer_Pass passes[ GPU_TIMER_MAX_PASSES+1 ] = { { "gpu frame" } };
+static int pass_count = 1;
+static int dropped_frames = 0;
+
+static int find_pass( const char* name ) {
+	for ( int i = 0; i < pass_count; ++i ) {
+		if ( passes[i].name == name || strcmp( passes[i].name, name ) == 0 ) return i;
+	}
+	if ( pass_count == GPU_TIMER_MAX_PASSES+1 ) return -1;
+	memset( &passes[pass_count], 0, sizeof(Gpu_Timer_Pass) );
+	passes[pass_count].name = name;
+	return pass_count++;
+}
+
+// Returns false without waiting if the GPU has not finished the frame yet.
+static bool collect_frame( Gpu_Timer_Frame& frame ) {
+	if ( frame.pass_count == 0 ) return true;
+
+	GLint available = 0;
+	glGetQueryObjectiv( frame.queries[ frame.pass_count*2-1 ], GL_QUERY_RESULT_AVAILABLE, &available );
+	if ( !available ) return false;
+
+	uint64_t pass_ns[ GPU_TIMER_MAX_PASSES+1 ] = {};
+	bool seen[ GPU_TIMER_MAX_PASSES+1 ] = { true };
+	GLuint64 first = 0, last = 0;
+	for ( int i = 0; i < frame.pass_count; ++i ) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v( frame.queries[i*2+0], GL_QUERY_RESULT, &begin );
+		glGetQueryObjectui64v( frame.queries[i*2+1], GL_QUERY_RESULT, &end );
+		if ( i == 0 ) first = begin;
+		last = end;
+
+		int pass = find_pass( frame.names[i] );
+		if ( pass < 0 ) continue;
+		seen[pass] = true;
+		if ( end > begin ) pass_ns[pass] += end - begin;
+	}
+	pass_ns[0] = last > first ? last - first : 0;
+
+	for ( int i = 0; i < pass_count; ++i ) {
+		if ( !seen[i] ) continue;
+		Gpu_Timer_Pass& pass = passes[i];
+		pass.history[ pass.history_index ] = pass_ns[i];
+		pass.history_index = ( pass.history_index + 1 ) % PROFILER_HISTORY_FRAMES;
+		if ( pass.history_count < PROFILER_HISTORY_FRAMES ) pass.history_count++;
+	}
+	return true;
+}
+
+void gpu_timer_begin_frame() {
+	if ( pass_open ) gpu_timer_end_pass();
+
+	current_frame = ( current_frame + 1 ) % GPU_TIMER_LATENCY;
+	Gpu_Timer_Frame& frame = frames[ current_frame ];
+
+	// This slot was last used GPU_TIMER_LATENCY frames ago. If it is still not
+	// ready the results are dropped, the queries are simply reissued below.
+	if ( frame.pending && !collect_frame( frame ) ) dropped_frames++;
+
+	if ( frame.queries[0] == 0 ) glGenQueries( GPU_TIMER_MAX_PASSES*2, frame.queries );
+	frame.pass_count = 0;
+	frame.pending = false;
+}
+
+void gpu_timer_begin_pass( const char* name ) {
+	if ( current_frame < 0 ) return;
+	Gpu_Timer_Frame& frame = frames[ current_frame ];
+	if ( pass_open ) gpu_timer_end_pass();
+	if ( frame.pass_count == GPU_TIMER_MAX_PASSES ) return;
+
+	frame.names[ frame.pass_count ] = name;
+	glQueryCounter( frame.queries[ frame.pass_count*2 ], GL_TIMESTAMP );
+	pass_open = true;
+}
+
+void gpu_timer_end_pass() {
+	if ( current_frame < 0 || !pass_open ) return;
+	Gpu_Timer_Frame& frame = frames[ current_frame ];
+
+	glQueryCounter( frame.queries[ frame.pass_count*2+1 ], GL_TIMESTAMP );
+	frame.pass_count++;
+	frame.pending = true;
+	pass_open = false;
+}
+
+int gpu_timer_pass_count() {
+	return pass_count;
+}
+
+const char* gpu_timer_pass_name( int pass ) {
+	if ( pass < 0 || pass >= pass_count ) return nullptr;
+	return passes[pass].name;
+}
+
+Profile_Zone_Stats gpu_timer_pass_stats( int pass ) {
+	if ( pass < 0 || pass >= pass_count ) return Profile_Zone_Stats();
+	return profiler_history_stats( passes[pass].history, passes[pass].history_count );
+}
+
+int gpu_timer_dropped_frames() {
+	return dropped_frames;
+}
+
+std::string gpu_timer_report() {
+	std::string report;
+	char line[128];
+	for ( int i = 0; i < pass_count; ++i ) {
+		Profile_Zone_Stats stats = gpu_timer_pass_stats( i );
+		std::string name = std::string( i == 0 ? 0 : 2, ' ' ) + gpu_timer_pass_name( i );
+		snprintf( line, sizeof(line), "%s%-22s %7.2f %7.2f %7.2f %7.2f", i == 0 ? "" : "\n", name.c_str(), stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms );
+		report += line;
+	}
+	return report;
+}
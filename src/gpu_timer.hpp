@@ -0,0 +1,39 @@
+//
+//  gpu_timer.hpp
+//  Isometric Demo
+//
+//  GPU pass timing with GL_TIMESTAMP queries. Each frame's queries are
+//  only read back GPU_TIMER_LATENCY frames later, and only if they are
+//  already available, so reading the results never stalls the pipeline.
+//
+
+#ifndef _gpu_timer_hpp_
+#define _gpu_timer_hpp_
+
+#define GPU_TIMER_LATENCY 4
+#define GPU_TIMER_MAX_PASSES 8
+
+void gpu_timer_begin_frame(); // Collects the oldest frame in the ring and starts a new one.
+void gpu_timer_begin_pass( const char* name );
+void gpu_timer_end_pass();
+
+// The timings of the most recent frame that has been read back, in milliseconds.
+// The "gpu frame" entry spans from the first pass to the last one.
+int gpu_timer_pass_count();
+const char* gpu_timer_pass_name( int pass );
+Profile_Zone_Stats gpu_timer_pass_stats( int pass );
+
+// Frames whose queries were not ready when their slot was reused.
+int gpu_timer_dropped_frames();
+
+// Same layout as profiler_report(), one line per pass.
+std::string gpu_timer_report();
+
+struct Gpu_Timer_Scope {
+	Gpu_Timer_Scope( const char* name ) { gpu_timer_begin_pass( name ); }
+	~Gpu_Timer_Scope() { gpu_timer_end_pass(); }
+};
+
+#define GPU_TIMER_SCOPE( name ) Gpu_Timer_Scope PROFILE_SCOPE_JOIN(gpu_timer_scope_, __LINE__)( name )
+
+#endif
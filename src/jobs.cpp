@@ -0,0 +1,102 @@
+//
+//  jobs.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "jobs.hpp"
+
+static int thread_count = 0; // 0 until set_job_threads() or the first run_jobs().
+static std::vector<std::thread> workers;
+
+static std::mutex jobs_mutex;
+static std::condition_variable jobs_started;
+static std::condition_variable jobs_finished;
+static const std::function<void( int )>* current_job = nullptr;
+static int job_count = 0;
+static std::atomic<int> next_job( 0 );
+static int busy_workers = 0;
+static uint64_t batch = 0; // Counts the run_jobs() calls, so the workers can tell a new batch from a spurious wake up.
+static bool stopping = false;
+
+static void run_remaining_jobs() {
+	for ( int job = next_job++; job < job_count; job = next_job++ ) ( *current_job )( job );
+}
+
+static void worker_main() {
+	uint64_t seen = 0;
+	std::unique_lock<std::mutex> lock( jobs_mutex );
+	for ( ;; ) {
+		jobs_started.wait( lock, [&]() { return stopping || batch != seen; } );
+		if ( stopping ) return;
+		seen = batch;
+		lock.unlock();
+		run_remaining_jobs();
+		lock.lock();
+		if ( --busy_workers == 0 ) jobs_finished.notify_one();
+	}
+}
+
+static void start_jobs() {
+	// Workers still waiting when the process exits would abort it.
+	static bool registered = false;
+	if ( !registered ) { atexit( stop_jobs ); registered = true; }
+
+	if ( thread_count <= 0 ) thread_count = std::max( 1, (int)std::thread::hardware_concurrency() );
+	stopping = false;
+	for ( int i = 1; i < thread_count; ++i ) workers.push_back( std::thread( worker_main ) );
+}
+
+void stop_jobs() {
+	{
+		std::lock_guard<std::mutex> lock( jobs_mutex );
+		stopping = true;
+	}
+	jobs_started.notify_all();
+	for ( std::thread& worker : workers ) worker.join();
+	workers.clear();
+}
+
+void set_job_threads( int count ) {
+	stop_jobs();
+	thread_count = count > 0 ? count : std::max( 1, (int)std::thread::hardware_concurrency() );
+}
+
+int job_threads() {
+	if ( thread_count <= 0 ) return std::max( 1, (int)std::thread::hardware_concurrency() );
+	return thread_count;
+}
+
+void run_jobs( int count, const std::function<void( int job )>& job ) {
+	if ( count <= 0 ) return;
+	if ( workers.empty() && job_threads() > 1 ) start_jobs();
+	if ( workers.empty() || count == 1 ) {
+		for ( int i = 0; i < count; ++i ) job( i );
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( jobs_mutex );
+		current_job = &job;
+		job_count = count;
+		next_job = 0;
+		busy_workers = (int)workers.size();
+		batch++;
+	}
+	jobs_started.notify_all();
+	run_remaining_jobs();
+
+	std::unique_lock<std::mutex> lock( jobs_mutex );
+	jobs_finished.wait( lock, []() { return busy_workers == 0; } );
+	current_job = nullptr;
+}
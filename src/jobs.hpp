@@ -0,0 +1,23 @@
+//
+//  jobs.hpp
+//  Isometric Demo
+//
+//  A fixed pool of worker threads for CPU work that splits into independent
+//  jobs, such as the slabs of world generation. run_jobs() hands the job
+//  indices out to the workers and to the calling thread, and returns once
+//  every job has run. Jobs must not depend on each other or on the order
+//  they run in, and can't call run_jobs() themselves.
+//
+
+#ifndef _jobs_hpp_
+#define _jobs_hpp_
+
+// The number of threads that run jobs, the calling thread included. 1 runs every job
+// on the calling thread, 0 uses one per core. The pool is started on first use.
+void set_job_threads( int count );
+int job_threads();
+
+void run_jobs( int count, const std::function<void( int job )>& job );
+void stop_jobs(); // Joins the workers, the next run_jobs() starts them again.
+
+#endif
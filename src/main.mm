@@ -1,8 +1,13 @@
 #import <Cocoa/Cocoa.h>
 #import <OpenGL/gl3.h>
 #import <mach/mach_time.h>
+#import <string.h>
+#import <stdio.h>
+#import <string>
 
 #import "game.hpp"
+#import "trace.hpp"
+#import "startup.hpp"
 #import <glm/glm.hpp>
 
 #define HANDMADE_USE_VSYNC_AND_DOUBLE_BUFFER 1
@@ -292,6 +297,8 @@ void toggle_fullscreen() {
 // Startup
 int main(int argc, const char* argv[]) {
 
+	startup_begin();
+
 	@autoreleasepool {
 
 		///////////////////////////////////
@@ -399,8 +406,18 @@ int main(int argc, const char* argv[]) {
 		//////////////////////////////
 		// Initialising the game:
 		// resize_view( [GLView bounds].size.width, [GLView bounds].size.height, [GLView bounds].size.width, [GLView bounds].size.height );
+		// '--trace file' writes a Chrome trace event timeline, starting before init_game() so startup is included.
+		for ( int i = 1; i+1 < argc; ++i ) {
+			if ( strcmp( argv[i], "--trace" ) == 0 ) trace_start( argv[i+1] );
+		}
+
 		init_game();
 
+		// '--record file' saves this session's input so it can be replayed by the headless build.
+		for ( int i = 1; i+1 < argc; ++i ) {
+			if ( strcmp( argv[i], "--record" ) == 0 ) start_input_recording( argv[i+1] );
+		}
+
 		////////////////////
 		// Run loop
 		float scroll_value = 0;
@@ -508,6 +525,7 @@ int main(int argc, const char* argv[]) {
 			#else
 				glFlush();
 			#endif
+			if ( !startup_finished() ) startup_first_frame();
 
 			// @NOTE(Xavier): This is what I am using for calculating the frame time.
 			uint64_t endTime = mach_absolute_time();
@@ -525,6 +543,9 @@ int main(int argc, const char* argv[]) {
 	}
 
 	// [NSCursor unhide];
+	stop_input_recording();
+	trace_stop();
+	printf( "%s\n", startup_report().c_str() );
 
 	printf("Handmade Cocoa Exited.\n");
 }
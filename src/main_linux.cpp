@@ -0,0 +1,313 @@
+//
+//  main_linux.cpp
+//  Isometric Demo
+//
+//  Headless platform layer. This drives the game from a plain main()
+//  using an offscreen EGL context (Mesa's llvmpipe works fine), so the
+//  game loop can run and be profiled on machines without a display.
+//
+
+#if defined(__linux__)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <functional>
+#include <atomic>
+
+#include "game.hpp"
+#include "sprite.hpp"
+#include "world.hpp"
+#include "bench.hpp"
+#include "profiler.hpp"
+#include "gpu_timer.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+#include "regress.hpp"
+#include "startup.hpp"
+#include "jobs.hpp"
+#include "noise.hpp"
+#include "worldfile.hpp"
+
+extern bool down_keys[256];
+extern glm::vec2 gl_viewport_size;
+
+static EGLDisplay egl_display = EGL_NO_DISPLAY;
+static EGLSurface egl_surface = EGL_NO_SURFACE;
+static EGLContext egl_context = EGL_NO_CONTEXT;
+
+void refresh_after_resize() {
+	glViewport( 0, 0, gl_viewport_size.x, gl_viewport_size.y );
+	glClearColor( 0, 0, 0, 1 );
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+}
+
+void hide_cursor() {}
+
+void unhide_cursor() {}
+
+// @NOTE: The pbuffer surface gives the game a default framebuffer
+// to render to, so render_game() does not need to know it is headless.
+static bool create_headless_context( int width, int height ) {
+
+	PFNEGLGETPLATFORMDISPLAYEXTPROC eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+	if ( eglGetPlatformDisplayEXT ) egl_display = eglGetPlatformDisplayEXT( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+	if ( egl_display == EGL_NO_DISPLAY ) egl_display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+
+	EGLint major, minor;
+	if ( !eglInitialize( egl_display, &major, &minor ) ) { printf( "eglInitialize failed (0x%x)\n", eglGetError() ); return false; }
+
+	const EGLint config_attributes[] = {
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_ALPHA_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+	EGLConfig config;
+	EGLint num_configs = 0;
+	if ( !eglChooseConfig( egl_display, config_attributes, &config, 1, &num_configs ) || num_configs == 0 ) { printf( "eglChooseConfig failed (0x%x)\n", eglGetError() ); return false; }
+
+	const EGLint surface_attributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+	egl_surface = eglCreatePbufferSurface( egl_display, config, surface_attributes );
+	if ( egl_surface == EGL_NO_SURFACE ) { printf( "eglCreatePbufferSurface failed (0x%x)\n", eglGetError() ); return false; }
+
+	eglBindAPI( EGL_OPENGL_API );
+	const EGLint context_attributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	egl_context = eglCreateContext( egl_display, config, EGL_NO_CONTEXT, context_attributes );
+	if ( egl_context == EGL_NO_CONTEXT ) { printf( "eglCreateContext failed (0x%x)\n", eglGetError() ); return false; }
+
+	if ( !eglMakeCurrent( egl_display, egl_surface, egl_surface, egl_context ) ) { printf( "eglMakeCurrent failed (0x%x)\n", eglGetError() ); return false; }
+
+	printf( "EGL %d.%d: %s, %s\n", major, minor, glGetString( GL_RENDERER ), glGetString( GL_VERSION ) );
+	return true;
+}
+
+static void destroy_headless_context() {
+	eglMakeCurrent( egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+	if ( egl_context != EGL_NO_CONTEXT ) eglDestroyContext( egl_display, egl_context );
+	if ( egl_surface != EGL_NO_SURFACE ) eglDestroySurface( egl_display, egl_surface );
+	eglTerminate( egl_display );
+}
+
+// The resources are loaded relative to the project directory,
+// which is the parent of the directory the executable is built into.
+static void set_working_directory() {
+	char path[4096];
+	ssize_t length = readlink( "/proc/self/exe", path, sizeof(path)-1 );
+	if ( length <= 0 ) return;
+	path[length] = 0;
+	char* dir = dirname( path );
+	if ( chdir( dir ) != 0 || chdir( ".." ) != 0 ) { printf( "Directory Error!!!!!!\n" ); }
+}
+
+static void print_usage() {
+	printf( "Usage: IsoDemo [options]\n" );
+	printf( "  --frames N       Number of frames to run before exiting (default 300, or the whole replay).\n" );
+	printf( "  --size WxH       Size of the offscreen framebuffer (default 960x540).\n" );
+	printf( "  --menu           Stay on the main menu instead of clicking Play.\n" );
+	printf( "  --world XxZ[xY]  Size of the world in tiles (default %dx%dx%d).\n", WORLD_DEFAULT_SIZE_X, WORLD_DEFAULT_SIZE_Z, WORLD_DEFAULT_SIZE_Y );
+	printf( "  --morton         Store the tiles inside each chunk in Morton order.\n" );
+	printf( "  --threads N      Threads for world generation (default one per core).\n" );
+	printf( "  --noise NAME     Noise kernel for world generation: scalar, sse2 or avx2 (default the widest the CPU has).\n" );
+	printf( "  --seed N         Seed for the world generator (default 0, the original world).\n" );
+	printf( "  --world-cache DIR  Where generated worlds are cached (default %s).\n", WORLD_CACHE_DIRECTORY );
+	printf( "  --no-world-cache Always generate the world.\n" );
+	printf( "  --world-file PATH  Load the world from PATH, or generate it and save it there.\n" );
+	printf( "  --record PATH    Record the input of every frame to PATH.\n" );
+	printf( "  --replay PATH    Replay recorded input, using its window size and time steps.\n" );
+	printf( "  --fixed-dt S     Step every frame by S seconds, when recording and replaying too.\n" );
+	printf( "  --bench NAME     Run a benchmark and exit. NAME is one of: worldgen, meshing, layout, worldfile, threads, noise.\n" );
+	printf( "  --iterations N   Number of benchmark iterations (default 5).\n" );
+	printf( "  --json PATH      Write the benchmark report to PATH instead of stdout.\n" );
+	printf( "  --regress        Run the golden image and performance budget regression suite and exit.\n" );
+	printf( "  --update-golden  With --regress, replace the golden images with the current frames.\n" );
+	printf( "  --startup-json PATH  Write the startup phase report to PATH as JSON.\n" );
+	printf( "  --trace PATH     Write a Chrome trace event file ( chrome://tracing, ui.perfetto.dev ) to PATH.\n" );
+}
+
+///////////////////////////////////////////////////////////////////////
+// Startup
+int main( int argc, const char* argv[] ) {
+	startup_begin();
+
+	int frame_count = -1;
+	int width = 960;
+	int height = 540;
+	bool stay_in_menu = false;
+	const char* bench_name = nullptr;
+	const char* json_path = nullptr;
+	int iterations = 5;
+	const char* record_path = nullptr;
+	const char* replay_path = nullptr;
+	const char* trace_path = nullptr;
+	const char* startup_json_path = nullptr;
+	bool regress = false;
+	bool update_golden = false;
+	int world_x = WORLD_DEFAULT_SIZE_X;
+	int world_z = WORLD_DEFAULT_SIZE_Z;
+	int world_y = WORLD_DEFAULT_SIZE_Y;
+	Chunk_Layout world_layout = CHUNK_LINEAR;
+	const char* world_file_path = nullptr;
+
+	for ( int i = 1; i < argc; ++i ) {
+		if ( strcmp( argv[i], "--frames" ) == 0 && i+1 < argc ) { frame_count = atoi( argv[++i] ); }
+		else if ( strcmp( argv[i], "--size" ) == 0 && i+1 < argc ) { sscanf( argv[++i], "%dx%d", &width, &height ); }
+		else if ( strcmp( argv[i], "--menu" ) == 0 ) { stay_in_menu = true; }
+		else if ( strcmp( argv[i], "--morton" ) == 0 ) { world_layout = CHUNK_MORTON; }
+		else if ( strcmp( argv[i], "--world" ) == 0 && i+1 < argc ) { if ( sscanf( argv[++i], "%dx%dx%d", &world_x, &world_z, &world_y ) < 2 ) { print_usage(); return 1; } }
+		else if ( strcmp( argv[i], "--threads" ) == 0 && i+1 < argc ) { set_job_threads( atoi( argv[++i] ) ); }
+		else if ( strcmp( argv[i], "--noise" ) == 0 && i+1 < argc ) { Noise_Kernel kernel; if ( !find_noise_kernel( argv[++i], &kernel ) ) { print_usage(); return 1; } set_noise_kernel( kernel ); }
+		else if ( strcmp( argv[i], "--seed" ) == 0 && i+1 < argc ) { world_generator.seed = (uint32_t)strtoul( argv[++i], nullptr, 10 ); }
+		else if ( strcmp( argv[i], "--world-cache" ) == 0 && i+1 < argc ) { set_world_cache( argv[++i] ); }
+		else if ( strcmp( argv[i], "--no-world-cache" ) == 0 ) { set_world_cache( nullptr ); }
+		else if ( strcmp( argv[i], "--world-file" ) == 0 && i+1 < argc ) { world_file_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--record" ) == 0 && i+1 < argc ) { record_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--replay" ) == 0 && i+1 < argc ) { replay_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--fixed-dt" ) == 0 && i+1 < argc ) { set_fixed_delta_time( (float)atof( argv[++i] ) ); }
+		else if ( strcmp( argv[i], "--bench" ) == 0 && i+1 < argc ) { bench_name = argv[++i]; }
+		else if ( strcmp( argv[i], "--iterations" ) == 0 && i+1 < argc ) { iterations = atoi( argv[++i] ); }
+		else if ( strcmp( argv[i], "--json" ) == 0 && i+1 < argc ) { json_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--trace" ) == 0 && i+1 < argc ) { trace_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--regress" ) == 0 ) { regress = true; }
+		else if ( strcmp( argv[i], "--startup-json" ) == 0 && i+1 < argc ) { startup_json_path = argv[++i]; }
+		else if ( strcmp( argv[i], "--update-golden" ) == 0 ) { update_golden = true; }
+		else { print_usage(); return 1; }
+	}
+
+	// Benchmarks and the regression suite time and check generating the world, so they never load it from the cache.
+	if ( bench_name || regress ) set_world_cache( nullptr );
+
+	set_working_directory();
+
+	if ( trace_path && !trace_start( trace_path ) ) return 1;
+
+	create_world( world_x, world_y, world_z, world_layout );
+
+	// The benchmarks that only touch the CPU side run without a GL context.
+	if ( bench_name ) {
+		int result = 1;
+		if ( strcmp( bench_name, "worldgen" ) == 0 ) result = run_world_generation_benchmark( iterations, json_path );
+		else if ( strcmp( bench_name, "meshing" ) == 0 ) result = run_world_meshing_benchmark( iterations, json_path );
+		else if ( strcmp( bench_name, "layout" ) == 0 ) result = run_world_layout_benchmark( iterations, json_path );
+		else if ( strcmp( bench_name, "threads" ) == 0 ) result = run_world_threads_benchmark( iterations, json_path );
+		else if ( strcmp( bench_name, "noise" ) == 0 ) result = run_noise_benchmark( iterations, json_path );
+		else if ( strcmp( bench_name, "worldfile" ) == 0 ) result = run_world_file_benchmark( iterations, json_path, world_file_path ? world_file_path : "builds/bench.world" );
+		else print_usage();
+		trace_stop();
+		return result;
+	}
+
+	if ( regress ) {
+		width = REGRESS_WIDTH;
+		height = REGRESS_HEIGHT;
+	} else if ( replay_path ) {
+		if ( !start_input_replay( replay_path ) ) return 1;
+		float replay_width, replay_height;
+		get_input_replay_window_size( &replay_width, &replay_height );
+		width = (int)replay_width;
+		height = (int)replay_height;
+	} else if ( frame_count < 0 ) {
+		frame_count = 300;
+	}
+
+	startup_begin_phase( "gl context" );
+	if ( !create_headless_context( width, height ) ) return 1;
+	startup_end_phase();
+
+	//////////////////////////////
+	// Initialising the game:
+	glViewport( 0, 0, width, height );
+	resize_view( width, height, width, height );
+	if ( world_file_path ) set_world_file( world_file_path );
+	init_game();
+	if ( record_path && !start_input_recording( record_path ) ) return 1;
+
+	if ( regress ) {
+		int result = run_regression_suite( update_golden );
+		trace_stop();
+		destroy_headless_context();
+		return result;
+	}
+
+	////////////////////
+	// Run loop
+	uint64_t run_start = get_time_ns();
+	uint64_t slowest_frame = 0;
+	int frame = 0;
+	for ( ; frame_count < 0 || frame < frame_count; ++frame ) {
+		uint64_t frame_start = get_time_ns();
+
+		///////////////////////
+		// Game Input:
+		// @NOTE: The first two frames press and release the Play
+		// button so the run measures the game rather than the menu.
+		// The y coordinate is flipped the same way Cocoa reports it.
+		unsigned int mouse_button = ( !stay_in_menu && frame == 0 ) ? 1 : 0;
+		set_mouse_position( width/2.0f, height/2.0f + 45.0f );
+		set_mouse_state( mouse_button );
+		set_mouse_scroll_value( 0 );
+		input_game();
+		if ( input_replay_finished() ) break;
+
+		///////////////////
+		// Game Update:
+		update_game();
+
+		/////////////////
+		// Game Render:
+		render_game();
+		{
+			TRACE_SCOPE( "glFinish" );
+			glFinish();
+		}
+		if ( frame == 0 ) startup_first_frame();
+
+		uint64_t frame_time = get_time_ns() - frame_start;
+		if ( frame_time > slowest_frame ) slowest_frame = frame_time;
+	}
+	uint64_t run_time = get_time_ns() - run_start;
+
+	stop_input_recording();
+
+	if ( frame > 0 ) {
+		printf( "Frames: %d, avg: %.3f ms, max: %.3f ms\n", frame, run_time/1000000.0/frame, slowest_frame/1000000.0 );
+		profiler_end_frame();
+		printf( "%s\n", profiler_report().c_str() );
+		printf( "%s\n", gpu_timer_report().c_str() );
+		printf( "GPU timer frames dropped: %d\n", gpu_timer_dropped_frames() );
+		printf( "%s\n", memory_report( 10 ).c_str() );
+	}
+
+	printf( "%s\n", startup_report().c_str() );
+	if ( startup_json_path ) {
+		FILE* file = fopen( startup_json_path, "w" );
+		if ( file ) { write_startup_json( file ); fclose( file ); }
+		else printf( "Unable to write %s.\n", startup_json_path );
+	}
+
+	trace_stop();
+	destroy_headless_context();
+	printf( "Headless run exited.\n" );
+	return 0;
+}
+
+#endif
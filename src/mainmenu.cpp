@@ -1,4 +1,4 @@
-#include <OpenGL/gl3.h>
+#include "platform.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <ft2build.h>
@@ -0,0 +1,104 @@
+//
+//  memory.cpp
+//  Isometric Demo
+//
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "memory.hpp"
+
+// Sprite batches untrack themselves in their destructors, and some of them are globals
+// ( eg. the world's layers ), so the table is never destroyed to keep it valid at exit.
+static std::unordered_map<const void*, Memory_Resource>& resources = *new std::unordered_map<const void*, Memory_Resource>();
+static size_t total_cpu = 0;
+static size_t total_gpu = 0;
+
+static Memory_Resource& find_resource( const void* key, const char* name ) {
+	auto it = resources.find( key );
+	if ( it == resources.end() ) {
+		Memory_Resource& resource = resources[key];
+		resource.name = name ? name : "unnamed";
+		resource.cpu_bytes = 0;
+		resource.gpu_bytes = 0;
+		return resource;
+	}
+	if ( name ) it->second.name = name;
+	return it->second;
+}
+
+void memory_track( const void* key, const char* name, size_t cpu_bytes, size_t gpu_bytes ) {
+	Memory_Resource& resource = find_resource( key, name );
+	total_cpu += cpu_bytes - resource.cpu_bytes;
+	total_gpu += gpu_bytes - resource.gpu_bytes;
+	resource.cpu_bytes = cpu_bytes;
+	resource.gpu_bytes = gpu_bytes;
+}
+
+void memory_track_cpu( const void* key, const char* name, size_t cpu_bytes ) {
+	Memory_Resource& resource = find_resource( key, name );
+	total_cpu += cpu_bytes - resource.cpu_bytes;
+	resource.cpu_bytes = cpu_bytes;
+}
+
+void memory_name( const void* key, const char* name ) {
+	find_resource( key, name );
+}
+
+void memory_untrack( const void* key ) {
+	auto it = resources.find( key );
+	if ( it == resources.end() ) return;
+	total_cpu -= it->second.cpu_bytes;
+	total_gpu -= it->second.gpu_bytes;
+	resources.erase( it );
+}
+
+size_t memory_total_cpu() {
+	return total_cpu;
+}
+
+size_t memory_total_gpu() {
+	return total_gpu;
+}
+
+int memory_resource_count() {
+	return (int)resources.size();
+}
+
+std::vector<Memory_Resource> memory_top_resources( int count ) {
+	std::vector<Memory_Resource> sorted;
+	sorted.reserve( resources.size() );
+	for ( auto& it : resources ) sorted.push_back( it.second );
+
+	count = std::min( std::max( count, 0 ), (int)sorted.size() );
+	std::partial_sort( sorted.begin(), sorted.begin() + count, sorted.end(), []( const Memory_Resource& a, const Memory_Resource& b ) {
+		if ( a.cpu_bytes + a.gpu_bytes != b.cpu_bytes + b.gpu_bytes ) return a.cpu_bytes + a.gpu_bytes > b.cpu_bytes + b.gpu_bytes;
+		return a.name < b.name;
+	} );
+	sorted.resize( count );
+	return sorted;
+}
+
+std::string memory_report( int count ) {
+	std::string report;
+	char line[128];
+	snprintf( line, sizeof(line), "%-22s %7s %7s", "memory KB", "cpu", "gl" );
+	report += line;
+	char total[32];
+	snprintf( total, sizeof(total), "total of %d", memory_resource_count() );
+	snprintf( line, sizeof(line), "\n%-22s %7zu %7zu", total, total_cpu/1024, total_gpu/1024 );
+	report += line;
+
+	std::vector<Memory_Resource> top = memory_top_resources( count );
+	for ( size_t i = 0; i < top.size(); ++i ) {
+		// Long names ( eg. file paths ) keep their end so the columns stay aligned.
+		std::string name = "  " + top[i].name;
+		if ( name.size() > 22 ) name = "  ..." + name.substr( name.size() - 17 );
+		snprintf( line, sizeof(line), "\n%-22s %7zu %7zu", name.c_str(), top[i].cpu_bytes/1024, top[i].gpu_bytes/1024 );
+		report += line;
+	}
+	return report;
+}
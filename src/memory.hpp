@@ -0,0 +1,37 @@
+//
+//  memory.hpp
+//  Isometric Demo
+//
+//  Bookkeeping of the bytes held by long lived resources. Each resource is
+//  keyed by the address of the object that owns it, and reports the memory
+//  it keeps on the CPU ( eg. vector capacity ) and what it uploaded to GL.
+//  GL sizes are what was passed to glBufferData / glTexImage2D, the driver
+//  may round them up.
+//
+
+#ifndef _memory_hpp_
+#define _memory_hpp_
+
+struct Memory_Resource {
+	std::string name;
+	size_t cpu_bytes;
+	size_t gpu_bytes;
+};
+
+// Sets the sizes of a resource, adding it if it is new. A null 'name' keeps the current name.
+void memory_track( const void* key, const char* name, size_t cpu_bytes, size_t gpu_bytes );
+void memory_track_cpu( const void* key, const char* name, size_t cpu_bytes ); // Leaves the GL size alone.
+void memory_name( const void* key, const char* name );
+void memory_untrack( const void* key );
+
+size_t memory_total_cpu();
+size_t memory_total_gpu();
+int memory_resource_count();
+
+// The 'count' largest resources by CPU + GL bytes, largest first.
+std::vector<Memory_Resource> memory_top_resources( int count );
+
+// Totals and the top 'count' resources, one per line, in the overlay's format.
+std::string memory_report( int count );
+
+#endif
@@ -0,0 +1,436 @@
+//
+//  noise.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <math.h>
+#include <string.h>
+
+#include "perlin.hpp"
+#include "simplex.hpp"
+#include "noise.hpp"
+
+// The kernels are written once over GCC / Clang vector types, and built
+// 4 wide for SSE2 and 8 wide in a function targeting AVX2.
+#if defined( __x86_64__ ) || defined( __i386__ )
+#define NOISE_X86 1
+#define NOISE_TARGET_AVX2 __attribute__(( target( "avx2" ) ))
+#else
+#define NOISE_X86 0
+#define NOISE_TARGET_AVX2
+#endif
+
+// Everything the kernels call is inlined into them, so it is built for their target.
+#define NOISE_INLINE static inline __attribute__(( always_inline ))
+
+template <int W> struct Noise_Lanes {
+	typedef float F __attribute__(( vector_size( W*4 ) ));
+	typedef int32_t I __attribute__(( vector_size( W*4 ) ));
+	typedef double D __attribute__(( vector_size( W*8 ) ));
+};
+
+// Lanes of 'a' where 'mask' is set, 'b' elsewhere.
+template <typename F, typename I>
+NOISE_INLINE F noise_select( I mask, F a, F b ) {
+	return (F)( ( (I)a & mask ) | ( (I)b & ~mask ) );
+}
+
+///////////////////////////////////////////////////////////////////////
+// noise_2d()
+
+template <int W>
+NOISE_INLINE typename Noise_Lanes<W>::I noise_floor( typename Noise_Lanes<W>::F fp ) {
+	typedef typename Noise_Lanes<W>::I I;
+	I i = __builtin_convertvector( fp, I );
+	return i + ( fp < __builtin_convertvector( i, typename Noise_Lanes<W>::F ) ); // The mask is -1 where it rounded up.
+}
+
+template <int W>
+NOISE_INLINE typename Noise_Lanes<W>::F noise_2d_grad( typename Noise_Lanes<W>::I hash, typename Noise_Lanes<W>::F x, typename Noise_Lanes<W>::F y ) {
+	typedef typename Noise_Lanes<W>::F F;
+	typedef typename Noise_Lanes<W>::I I;
+	I h = hash & 0x3F;
+	I low = h < 4;
+	F u = noise_select( low, x, y );
+	F v = noise_select( low, y, x );
+	return noise_select( ( h & 1 ) != 0, -u, u ) + noise_select( ( h & 2 ) != 0, -2.0f*v, 2.0f*v );
+}
+
+template <int W>
+NOISE_INLINE typename Noise_Lanes<W>::F noise_2d_corner( typename Noise_Lanes<W>::I hash, typename Noise_Lanes<W>::F x, typename Noise_Lanes<W>::F y ) {
+	typedef typename Noise_Lanes<W>::F F;
+	F t = 0.5f - x*x - y*y;
+	F t2 = t * t;
+	return noise_select( t < 0.0f, F{}, t2 * t2 * noise_2d_grad<W>( hash, x, y ) );
+}
+
+template <int W>
+NOISE_INLINE void noise_2d_lanes( const float* xs, float y, float* out ) {
+	typedef typename Noise_Lanes<W>::F F;
+	typedef typename Noise_Lanes<W>::I I;
+	const float F2 = 0.366025403f;
+	const float G2 = 0.211324865f;
+
+	F x;
+	memcpy( &x, xs, sizeof(F) );
+	F s = ( x + y ) * F2;
+	I i = noise_floor<W>( x + s );
+	I j = noise_floor<W>( y + s );
+	F t = __builtin_convertvector( i + j, F ) * G2;
+	F x0 = x - ( __builtin_convertvector( i, F ) - t );
+	F y0 = y - ( __builtin_convertvector( j, F ) - t );
+	I i1 = ( x0 > y0 ) & 1;
+	I j1 = 1 - i1;
+	F x1 = x0 - __builtin_convertvector( i1, F ) + G2;
+	F y1 = y0 - __builtin_convertvector( j1, F ) + G2;
+	F x2 = x0 - 1.0f + 2.0f * G2;
+	F y2 = y0 - 1.0f + 2.0f * G2;
+
+	I h0, h1, h2;
+	for ( int l = 0; l < W; ++l ) {
+		h0[l] = hash( i[l] + hash( j[l] ) );
+		h1[l] = hash( i[l] + i1[l] + hash( j[l] + j1[l] ) );
+		h2[l] = hash( i[l] + 1 + hash( j[l] + 1 ) );
+	}
+
+	F n = noise_2d_corner<W>( h0, x0, y0 ) + noise_2d_corner<W>( h1, x1, y1 ) + noise_2d_corner<W>( h2, x2, y2 );
+	F result = 45.23065f * n;
+	memcpy( out, &result, sizeof(F) );
+}
+
+///////////////////////////////////////////////////////////////////////
+// simplex_noise()
+
+// The gradients of grad_simplex, from the index: ( ±1, ±1, 0 ) below 4, ( ±1, 0, ±1 ) below 8
+// and ( 0, ±1, ±1 ) from there, with bit 0 flipping the first of the two and bit 1 the second.
+template <int W>
+NOISE_INLINE typename Noise_Lanes<W>::F simplex_corner( typename Noise_Lanes<W>::I gi, typename Noise_Lanes<W>::F x, typename Noise_Lanes<W>::F y, typename Noise_Lanes<W>::F z ) {
+	typedef typename Noise_Lanes<W>::F F;
+	typedef typename Noise_Lanes<W>::D D;
+	typedef typename Noise_Lanes<W>::I I;
+	const F zero = {};
+	F first = noise_select( ( gi & 1 ) != 0, zero - 1.0f, zero + 1.0f );
+	F second = noise_select( ( gi & 2 ) != 0, zero - 1.0f, zero + 1.0f );
+	I low = gi < 4;
+	I middle = gi < 8;
+	F gx = noise_select( middle, first, zero );
+	F gy = noise_select( low, second, noise_select( middle, zero, first ) );
+	F gz = noise_select( low, zero, second );
+
+	// The scalar code subtracts the squares from a double.
+	F t = __builtin_convertvector( 0.6 - __builtin_convertvector( x*x, D ) - __builtin_convertvector( y*y, D ) - __builtin_convertvector( z*z, D ), F );
+	F t2 = t * t;
+	return noise_select( t < 0.0f, zero, t2 * t2 * ( x*gx + y*gy + z*gz ) );
+}
+
+template <int W>
+NOISE_INLINE typename Noise_Lanes<W>::F simplex_lanes( typename Noise_Lanes<W>::F xin, float yin, float zin ) {
+	typedef typename Noise_Lanes<W>::F F;
+	typedef typename Noise_Lanes<W>::D D;
+	typedef typename Noise_Lanes<W>::I I;
+	const float F3 = 1.0/3.0;
+	const float G3 = 1.0/6.0;
+
+	F s = ( xin + yin + zin ) * F3;
+	I i = __builtin_convertvector( xin + s, I ); // Truncated, as the scalar code does.
+	I j = __builtin_convertvector( yin + s, I );
+	I k = __builtin_convertvector( zin + s, I );
+	F t = __builtin_convertvector( i + j + k, F ) * G3;
+	F x0 = xin - ( __builtin_convertvector( i, F ) - t );
+	F y0 = yin - ( __builtin_convertvector( j, F ) - t );
+	F z0 = zin - ( __builtin_convertvector( k, F ) - t );
+
+	// The second and third corners from the order of x0, y0 and z0.
+	I xy = x0 >= y0;
+	I yz = y0 >= z0;
+	I xz = x0 >= z0;
+	I i1 = xy & xz & 1;
+	I j1 = ~xy & yz & 1;
+	I k1 = ~xz & ~yz & 1;
+	I i2 = ( xy | xz ) & 1;
+	I j2 = ( ~xy | yz ) & 1;
+	I k2 = ( ~xz | ~yz ) & 1;
+
+	F x1 = x0 - __builtin_convertvector( i1, F ) + G3;
+	F y1 = y0 - __builtin_convertvector( j1, F ) + G3;
+	F z1 = z0 - __builtin_convertvector( k1, F ) + G3;
+	F x2 = __builtin_convertvector( __builtin_convertvector( x0 - __builtin_convertvector( i2, F ), D ) + 2.0*G3, F );
+	F y2 = __builtin_convertvector( __builtin_convertvector( y0 - __builtin_convertvector( j2, F ), D ) + 2.0*G3, F );
+	F z2 = __builtin_convertvector( __builtin_convertvector( z0 - __builtin_convertvector( k2, F ), D ) + 2.0*G3, F );
+	F x3 = __builtin_convertvector( __builtin_convertvector( x0, D ) - 1.0 + 3.0*G3, F );
+	F y3 = __builtin_convertvector( __builtin_convertvector( y0, D ) - 1.0 + 3.0*G3, F );
+	F z3 = __builtin_convertvector( __builtin_convertvector( z0, D ) - 1.0 + 3.0*G3, F );
+
+	I gi0, gi1, gi2, gi3;
+	for ( int l = 0; l < W; ++l ) {
+		int ii = i[l] & 255;
+		int jj = j[l] & 255;
+		int kk = k[l] & 255;
+		gi0[l] = perm_simplex[ii+perm_simplex[jj+perm_simplex[kk]]] % 12;
+		gi1[l] = perm_simplex[ii+i1[l]+perm_simplex[jj+j1[l]+perm_simplex[kk+k1[l]]]] % 12;
+		gi2[l] = perm_simplex[ii+i2[l]+perm_simplex[jj+j2[l]+perm_simplex[kk+k2[l]]]] % 12;
+		gi3[l] = perm_simplex[ii+1+perm_simplex[jj+1+perm_simplex[kk+1]]] % 12;
+	}
+
+	F n = simplex_corner<W>( gi0, x0, y0, z0 ) + simplex_corner<W>( gi1, x1, y1, z1 ) + simplex_corner<W>( gi2, x2, y2, z2 ) + simplex_corner<W>( gi3, x3, y3, z3 );
+	return __builtin_convertvector( 16.0 * __builtin_convertvector( n, D ) + 1.0, F );
+}
+
+template <int W>
+NOISE_INLINE void simplex_noise_lanes( int octaves, const float* xs, float y, float z, float* out ) {
+	typedef typename Noise_Lanes<W>::F F;
+	F x;
+	memcpy( &x, xs, sizeof(F) );
+	F value = {};
+	float scale = 1; // pow( 2, i ), which is exact in a float.
+	for ( int i = 0; i < octaves; ++i, scale *= 2 ) value += simplex_lanes<W>( x * scale, y * scale, z * scale );
+	memcpy( out, &value, sizeof(F) );
+}
+
+///////////////////////////////////////////////////////////////////////
+// Rows
+
+// Whole groups of lanes, then the rest of the row padded out to a group.
+template <int W, typename Lanes>
+NOISE_INLINE void noise_row( const float* x, float* out, int count, Lanes lanes ) {
+	int i = 0;
+	for ( ; i + W <= count; i += W ) lanes( x + i, out + i );
+	if ( i < count ) {
+		float in[W] = {}, rest[W];
+		memcpy( in, x + i, ( count - i ) * sizeof(float) );
+		lanes( in, rest );
+		memcpy( out + i, rest, ( count - i ) * sizeof(float) );
+	}
+}
+
+static void noise_2d_row_sse2( const float* x, float y, float* out, int count ) {
+	noise_row<4>( x, out, count, [=]( const float* in, float* result ) { noise_2d_lanes<4>( in, y, result ); } );
+}
+
+static void simplex_noise_row_sse2( int octaves, const float* x, float y, float z, float* out, int count ) {
+	noise_row<4>( x, out, count, [=]( const float* in, float* result ) { simplex_noise_lanes<4>( octaves, in, y, z, result ); } );
+}
+
+// A lambda can't take the AVX2 target, so these loop over the row themselves and leave the rest to the 4 wide row.
+NOISE_TARGET_AVX2 static void noise_2d_row_avx2( const float* x, float y, float* out, int count ) {
+	int i = 0;
+	for ( ; i + 8 <= count; i += 8 ) noise_2d_lanes<8>( x + i, y, out + i );
+	noise_2d_row_sse2( x + i, y, out + i, count - i );
+}
+
+NOISE_TARGET_AVX2 static void simplex_noise_row_avx2( int octaves, const float* x, float y, float z, float* out, int count ) {
+	int i = 0;
+	for ( ; i + 8 <= count; i += 8 ) simplex_noise_lanes<8>( octaves, x + i, y, z, out + i );
+	simplex_noise_row_sse2( octaves, x + i, y, z, out + i, count - i );
+}
+
+///////////////////////////////////////////////////////////////////////
+// Seeds
+
+static uint32_t current_seed = 0;
+static uint8_t original_perm[256];
+static int original_perm_simplex[256];
+static bool originals_saved = false;
+
+// A Fisher-Yates shuffle of the original table, driven by splitmix64.
+template <typename T>
+static void shuffle_table( T* table, const T* original, uint64_t state ) {
+	for ( int i = 0; i < 256; ++i ) table[i] = original[i];
+	for ( int i = 255; i > 0; --i ) {
+		state += 0x9E3779B97F4A7C15ULL;
+		uint64_t z = state;
+		z = ( z ^ ( z >> 30 ) ) * 0xBF58476D1CE4E5B9ULL;
+		z = ( z ^ ( z >> 27 ) ) * 0x94D049BB133111EBULL;
+		z ^= z >> 31;
+		int j = (int)( z % (uint64_t)( i + 1 ) );
+		T swap = table[i];
+		table[i] = table[j];
+		table[j] = swap;
+	}
+}
+
+void set_noise_seed( uint32_t seed ) {
+	if ( !originals_saved ) {
+		memcpy( original_perm, perm, sizeof(original_perm) );
+		memcpy( original_perm_simplex, perm_simplex, sizeof(original_perm_simplex) );
+		originals_saved = true;
+	}
+	if ( seed == current_seed ) return;
+
+	if ( seed == 0 ) {
+		memcpy( perm, original_perm, sizeof(original_perm) );
+		memcpy( perm_simplex, original_perm_simplex, sizeof(original_perm_simplex) );
+	} else {
+		shuffle_table( perm, original_perm, seed );
+		shuffle_table( perm_simplex, original_perm_simplex, (uint64_t)seed << 32 | seed );
+	}
+	// simplex_noise() indexes past 255 rather than wrapping, so its table is stored twice.
+	memcpy( perm_simplex + 256, perm_simplex, 256 * sizeof(int) );
+	current_seed = seed;
+}
+
+uint32_t noise_seed() {
+	return current_seed;
+}
+
+///////////////////////////////////////////////////////////////////////
+// Kernels
+
+static const char* kernel_names[NOISE_KERNEL_COUNT] = { "scalar", "sse2", "avx2" };
+
+bool noise_kernel_supported( Noise_Kernel kernel ) {
+	switch ( kernel ) {
+	case NOISE_SCALAR: return true;
+	case NOISE_SSE2: return NOISE_X86 != 0;
+#if NOISE_X86
+	case NOISE_AVX2: __builtin_cpu_init(); return __builtin_cpu_supports( "avx2" ); // The init is needed before main().
+#endif
+	default: return false;
+	}
+}
+
+static Noise_Kernel widest_noise_kernel( Noise_Kernel kernel ) {
+	int k = kernel;
+	while ( k > NOISE_SCALAR && !noise_kernel_supported( (Noise_Kernel)k ) ) k--;
+	return (Noise_Kernel)k;
+}
+
+// Picked when the program starts, on the main thread, so the generator's jobs only ever read it.
+static Noise_Kernel current_kernel = widest_noise_kernel( NOISE_AVX2 );
+
+void set_noise_kernel( Noise_Kernel kernel ) {
+	current_kernel = widest_noise_kernel( kernel );
+}
+
+Noise_Kernel noise_kernel() {
+	return current_kernel;
+}
+
+const char* noise_kernel_name( Noise_Kernel kernel ) {
+	return kernel >= 0 && kernel < NOISE_KERNEL_COUNT ? kernel_names[kernel] : "unknown";
+}
+
+bool find_noise_kernel( const char* name, Noise_Kernel* kernel ) {
+	for ( int k = 0; k < NOISE_KERNEL_COUNT; ++k ) {
+		if ( strcmp( name, kernel_names[k] ) == 0 ) { *kernel = (Noise_Kernel)k; return true; }
+	}
+	return false;
+}
+
+void noise_2d_row( Noise_Kernel kernel, const float* x, float y, float* out, int count ) {
+	switch ( kernel ) {
+	case NOISE_SSE2: noise_2d_row_sse2( x, y, out, count ); break;
+	case NOISE_AVX2: noise_2d_row_avx2( x, y, out, count ); break;
+	default: for ( int i = 0; i < count; ++i ) out[i] = noise_2d( x[i], y ); break;
+	}
+}
+
+void noise_2d_row( const float* x, float y, float* out, int count ) {
+	noise_2d_row( noise_kernel(), x, y, out, count );
+}
+
+void simplex_noise_row( Noise_Kernel kernel, int octaves, const float* x, float y, float z, float* out, int count ) {
+	switch ( kernel ) {
+	case NOISE_SSE2: simplex_noise_row_sse2( octaves, x, y, z, out, count ); break;
+	case NOISE_AVX2: simplex_noise_row_avx2( octaves, x, y, z, out, count ); break;
+	default: for ( int i = 0; i < count; ++i ) out[i] = simplex_noise( octaves, x[i], y, z ); break;
+	}
+}
+
+void simplex_noise_row( int octaves, const float* x, float y, float z, float* out, int count ) {
+	simplex_noise_row( noise_kernel(), octaves, x, y, z, out, count );
+}
+
+///////////////////////////////////////////////////////////////////////
+// Fractal noise
+
+#define FRACTAL_NOISE_ROW 64 // Points per pass over the octaves.
+
+// Bounds on one octave of each basis, for stopping early. The largest found
+// by searching for extremes was 1.000001 from 0 for noise_2d(), and 0.4894
+// from 1 for simplex noise. The slack covers the rounding of the sums.
+static const float basis_low[] = { -1.01f, 0.5f };
+static const float basis_high[] = { 1.01f, 1.5f };
+
+Fractal_Noise make_fractal_noise( Fractal_Basis basis, int octaves, float scale, float persistence, float lacunarity ) {
+	if ( scale <= 0 ) scale = 0.0001f;
+	if ( octaves < 1 ) octaves = 1;
+	if ( octaves > FRACTAL_NOISE_MAX_OCTAVES ) octaves = FRACTAL_NOISE_MAX_OCTAVES;
+	if ( persistence > 1 ) persistence = 1;
+	if ( persistence < 0 ) persistence = 0;
+	if ( lacunarity < 1 ) lacunarity = 1;
+
+	Fractal_Noise noise = {};
+	noise.basis = basis;
+	noise.octaves = octaves;
+	noise.scale = scale;
+	float amplitude = 1.0f;
+	float frequency = 1.0f;
+	for ( int i = 0; i < octaves; ++i ) {
+		noise.frequencies[i] = frequency;
+		noise.amplitudes[i] = amplitude;
+		amplitude *= persistence;
+		frequency *= lacunarity;
+	}
+	for ( int i = octaves-1; i >= 0; --i ) {
+		noise.rest_low[i] = noise.rest_low[i+1] + noise.amplitudes[i] * basis_low[basis];
+		noise.rest_high[i] = noise.rest_high[i+1] + noise.amplitudes[i] * basis_high[basis];
+	}
+	return noise;
+}
+
+static void fractal_octave_row( const Fractal_Noise& noise, const float* x, float y, float z, float* out, int count ) {
+	Noise_Kernel kernel = noise_kernel();
+	if ( noise.basis == FRACTAL_NOISE_2D ) noise_2d_row( kernel, x, y, out, count );
+	else if ( kernel != NOISE_SCALAR ) simplex_noise_row( kernel, 1, x, y, z, out, count );
+	else for ( int i = 0; i < count; ++i ) out[i] = ::noise( x[i], y, z );
+}
+
+void fractal_noise_row( const Fractal_Noise& noise, const float* x, float y, float z, float* out, int count ) {
+	float points[FRACTAL_NOISE_ROW], samples[FRACTAL_NOISE_ROW], values[FRACTAL_NOISE_ROW];
+	float ys = y / noise.scale;
+	float zs = z / noise.scale;
+	for ( int start = 0; start < count; start += FRACTAL_NOISE_ROW ) {
+		int n = count - start < FRACTAL_NOISE_ROW ? count - start : FRACTAL_NOISE_ROW;
+		for ( int i = 0; i < n; ++i ) { points[i] = x[start+i] / noise.scale; out[start+i] = 0.0f; }
+		for ( int o = 0; o < noise.octaves; ++o ) {
+			float frequency = noise.frequencies[o];
+			for ( int i = 0; i < n; ++i ) samples[i] = points[i] * frequency;
+			fractal_octave_row( noise, samples, ys * frequency, zs * frequency, values, n );
+			for ( int i = 0; i < n; ++i ) out[start+i] += values[i] * noise.amplitudes[o];
+		}
+	}
+}
+
+// The points still undecided after each octave are packed together, so the next one is evaluated for them alone.
+int fractal_noise_below_row( const Fractal_Noise& noise, const float* x, float y, float z, float threshold, uint8_t* below, int count ) {
+	float points[FRACTAL_NOISE_ROW], sums[FRACTAL_NOISE_ROW], samples[FRACTAL_NOISE_ROW], values[FRACTAL_NOISE_ROW];
+	int active[FRACTAL_NOISE_ROW];
+	float ys = y / noise.scale;
+	float zs = z / noise.scale;
+	int evaluated = 0;
+	for ( int start = 0; start < count; start += FRACTAL_NOISE_ROW ) {
+		int n = count - start < FRACTAL_NOISE_ROW ? count - start : FRACTAL_NOISE_ROW;
+		for ( int i = 0; i < n; ++i ) { points[i] = x[start+i] / noise.scale; sums[i] = 0.0f; active[i] = i; }
+		for ( int o = 0; o < noise.octaves && n > 0; ++o ) {
+			float frequency = noise.frequencies[o];
+			for ( int a = 0; a < n; ++a ) samples[a] = points[ active[a] ] * frequency;
+			fractal_octave_row( noise, samples, ys * frequency, zs * frequency, values, n );
+			evaluated += n;
+
+			// After the last octave there is nothing left to add, and every point is decided.
+			int undecided = 0;
+			for ( int a = 0; a < n; ++a ) {
+				int i = active[a];
+				sums[i] += values[a] * noise.amplitudes[o];
+				if ( sums[i] + noise.rest_high[o+1] < threshold ) below[start+i] = 1;
+				else if ( sums[i] + noise.rest_low[o+1] >= threshold ) below[start+i] = 0;
+				else active[undecided++] = i;
+			}
+			n = undecided;
+		}
+	}
+	return evaluated;
+}
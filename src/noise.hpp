@@ -0,0 +1,89 @@
+//
+//  noise.hpp
+//  Isometric Demo
+//
+//  Row versions of noise_2d() ( perlin.hpp ) and simplex_noise() ( simplex.hpp ),
+//  for the world generator, which samples the noise a row of x at a time.
+//  The row kernels evaluate 4 points at once with SSE2 or 8 with AVX2:
+//
+//  - the simplex corner of each lane is picked with compare masks instead
+//    of the scalar if chains,
+//  - only the permutation table is looked up per lane, the gradients come
+//    from the bits of the hash rather than from a table,
+//  - every lane does the same float and double operations in the same order
+//    as the scalar functions, so the rows come out equal to them.
+//
+//  The scalar kernel loops over the original functions, and is what runs
+//  where the CPU has neither. --bench noise checks each kernel against it,
+//  within NOISE_ROW_TOLERANCE.
+//
+//  Fractal_Noise sums octaves of either noise a row at a time, with the
+//  octave constants worked out up front, and can stop adding octaves to a
+//  point once the rest can no longer take its sum across a threshold.
+//
+//  Both noises hash the lattice with a permutation table. A seed shuffles
+//  the tables, and seed 0 keeps the ones they ship with, which generate the
+//  original world.
+//
+
+#ifndef _noise_hpp_
+#define _noise_hpp_
+
+#define NOISE_ROW_TOLERANCE 1e-5f // The most a row kernel may differ from the scalar noise.
+
+enum Noise_Kernel {
+	NOISE_SCALAR,
+	NOISE_SSE2, // 4 wide.
+	NOISE_AVX2, // 8 wide.
+	NOISE_KERNEL_COUNT
+};
+
+// Starts with the widest the CPU supports. Asking for one it doesn't support picks the widest it does. Not while noise is being evaluated.
+void set_noise_kernel( Noise_Kernel kernel );
+Noise_Kernel noise_kernel();
+bool noise_kernel_supported( Noise_Kernel kernel );
+const char* noise_kernel_name( Noise_Kernel kernel );
+bool find_noise_kernel( const char* name, Noise_Kernel* kernel );
+
+// Shuffles the permutation tables of noise_2d() and simplex_noise() for the seed. Not while noise is being evaluated.
+void set_noise_seed( uint32_t seed );
+uint32_t noise_seed();
+
+// out[i] = noise_2d( x[i], y ). The kernel given has to be supported.
+void noise_2d_row( const float* x, float y, float* out, int count );
+void noise_2d_row( Noise_Kernel kernel, const float* x, float y, float* out, int count );
+
+// out[i] = simplex_noise( octaves, x[i], y, z ).
+void simplex_noise_row( int octaves, const float* x, float y, float z, float* out, int count );
+void simplex_noise_row( Noise_Kernel kernel, int octaves, const float* x, float y, float z, float* out, int count );
+
+#define FRACTAL_NOISE_MAX_OCTAVES 16
+
+enum Fractal_Basis {
+	FRACTAL_NOISE_2D, // noise_2d( x, y ), z is ignored.
+	FRACTAL_SIMPLEX, // One octave of simplex_noise().
+};
+
+// Octave i adds amplitudes[i] times the noise at the point / scale * frequencies[i],
+// which gives the same sums as generateHeightmap() and simplex_noise() did.
+struct Fractal_Noise {
+	Fractal_Basis basis;
+	int octaves;
+	float scale;
+	float frequencies[FRACTAL_NOISE_MAX_OCTAVES];
+	float amplitudes[FRACTAL_NOISE_MAX_OCTAVES];
+	float rest_low[FRACTAL_NOISE_MAX_OCTAVES+1]; // The least and the most that octaves i and up can add.
+	float rest_high[FRACTAL_NOISE_MAX_OCTAVES+1];
+};
+
+// Frequencies go up by the lacunarity from 1, amplitudes down by the persistence from 1.
+// The scale is kept above 0, the octaves in 1..FRACTAL_NOISE_MAX_OCTAVES, the persistence in 0..1 and the lacunarity at 1 or more.
+Fractal_Noise make_fractal_noise( Fractal_Basis basis, int octaves, float scale, float persistence, float lacunarity );
+
+// out[i] = the noise at ( x[i], y, z ).
+void fractal_noise_row( const Fractal_Noise& noise, const float* x, float y, float z, float* out, int count );
+// below[i] = 1 where the noise at ( x[i], y, z ) is below the threshold, the same as comparing fractal_noise_row().
+// Returns how many octaves it evaluated over all the points.
+int fractal_noise_below_row( const Fractal_Noise& noise, const float* x, float y, float z, float threshold, uint8_t* below, int count );
+
+#endif
@@ -0,0 +1,37 @@
+//
+//  platform.hpp
+//  Isometric Demo
+//
+//  The OpenGL header and the clock differ between the Cocoa
+//  build and the headless Linux build. Everything that needs
+//  either of them should include this instead of the system headers.
+//
+
+#ifndef _platform_hpp_
+#define _platform_hpp_
+
+#include <stdint.h>
+
+#if defined(__APPLE__)
+	#include <OpenGL/gl3.h>
+	#include <mach/mach_time.h>
+#else
+	#define GL_GLEXT_PROTOTYPES
+	#include <GL/glcorearb.h>
+	#include <time.h>
+#endif
+
+// Returns a monotonic time in nanoseconds.
+static inline uint64_t get_time_ns () {
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t info;
+	if ( info.denom == 0 ) mach_timebase_info( &info );
+	return mach_absolute_time() * info.numer / info.denom;
+#else
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#endif
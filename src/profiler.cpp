@@ -0,0 +1,135 @@
+//
+//  profiler.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+#include <atomic>
+
+#include "profiler.hpp"
+#include "trace.hpp"
+
+// The frame itself is always zone 0, so it is listed first in the report.
+static Profile_Zone zones[ PROFILER_MAX_ZONES ] = { { "frame" } };
+static int zone_count = 1;
+static int zone_stack[ PROFILER_MAX_ZONES ];
+static int zone_stack_depth = 0;
+
+static uint64_t frame_start_ns = 0;
+static int history_index = 0;
+static int history_count = 0;
+
+static int find_zone( const char* name ) {
+	for ( int i = 0; i < zone_count; ++i ) {
+		if ( zones[i].name == name || strcmp( zones[i].name, name ) == 0 ) return i;
+	}
+	if ( zone_count == PROFILER_MAX_ZONES ) return -1;
+	Profile_Zone& zone = zones[ zone_count ];
+	memset( &zone, 0, sizeof(zone) );
+	zone.name = name;
+	return zone_count++;
+}
+
+void profiler_begin_frame() {
+	// The frame zone runs from one call to the next, so it includes the platform layer.
+	// Anything timed between frames ( eg. during init_game ) is discarded.
+	profiler_end_frame();
+	for ( int i = 0; i < zone_count; ++i ) { zones[i].frame_ns = 0; zones[i].calls = 0; }
+	zone_stack_depth = 0;
+	trace_begin( "frame" );
+	frame_start_ns = get_time_ns();
+}
+
+void profiler_end_frame() {
+	if ( frame_start_ns == 0 ) return;
+	zones[0].frame_ns = get_time_ns() - frame_start_ns;
+	zones[0].calls = 1;
+	trace_end( "frame" );
+
+	for ( int i = 0; i < zone_count; ++i ) {
+		zones[i].history[ history_index ] = zones[i].frame_ns;
+	}
+	history_index = ( history_index + 1 ) % PROFILER_HISTORY_FRAMES;
+	if ( history_count < PROFILER_HISTORY_FRAMES ) history_count++;
+	frame_start_ns = 0;
+}
+
+int profiler_begin_zone( const char* name ) {
+	// Zones also go to the timeline. The ones that did not fit in the table are left out of
+	// both, so their end has no name to give and the begin and end events stay paired.
+	int zone = find_zone( name );
+	if ( zone < 0 ) return -1;
+	trace_begin( name );
+	zones[zone].parent = zone_stack_depth > 0 ? zone_stack[ zone_stack_depth-1 ] : 0;
+	if ( zone_stack_depth < PROFILER_MAX_ZONES ) zone_stack[ zone_stack_depth++ ] = zone;
+	return zone;
+}
+
+void profiler_end_zone( int zone, uint64_t start_ns ) {
+	if ( zone < 0 ) return;
+	trace_end( zones[zone].name );
+	zones[zone].frame_ns += get_time_ns() - start_ns;
+	zones[zone].calls++;
+	if ( zone_stack_depth > 0 ) zone_stack_depth--;
+}
+
+int profiler_zone_count() {
+	return zone_count;
+}
+
+const Profile_Zone* profiler_get_zone( int zone ) {
+	if ( zone < 0 || zone >= zone_count ) return nullptr;
+	return &zones[zone];
+}
+
+Profile_Zone_Stats profiler_history_stats( const uint64_t* history, int count ) {
+	Profile_Zone_Stats stats = {};
+	if ( count <= 0 ) return stats;
+
+	uint64_t sorted[ PROFILER_HISTORY_FRAMES ];
+	if ( count > PROFILER_HISTORY_FRAMES ) count = PROFILER_HISTORY_FRAMES;
+	memcpy( sorted, history, count * sizeof(uint64_t) );
+	std::sort( sorted, sorted + count );
+
+	auto percentile = [&]( double p ) -> double {
+		int index = (int)( p * (count - 1) + 0.5 );
+		return sorted[index] / 1000000.0;
+	};
+	stats.p50_ms = percentile( 0.50 );
+	stats.p95_ms = percentile( 0.95 );
+	stats.p99_ms = percentile( 0.99 );
+	stats.max_ms = sorted[ count-1 ] / 1000000.0;
+	return stats;
+}
+
+Profile_Zone_Stats profiler_zone_stats( int zone ) {
+	if ( zone < 0 || zone >= zone_count ) return Profile_Zone_Stats();
+	return profiler_history_stats( zones[zone].history, history_count );
+}
+
+static void append_zone_report( std::string& report, int zone, int depth ) {
+	char line[128];
+	Profile_Zone_Stats stats = profiler_zone_stats( zone );
+	std::string name = std::string( depth*2, ' ' ) + zones[zone].name;
+	snprintf( line, sizeof(line), "\n%-22s %7.2f %7.2f %7.2f %7.2f", name.c_str(), stats.p50_ms, stats.p95_ms, stats.p99_ms, stats.max_ms );
+	report += line;
+
+	if ( depth >= 8 ) return;
+	for ( int i = 1; i < zone_count; ++i ) {
+		if ( i != zone && zones[i].parent == zone ) append_zone_report( report, i, depth+1 );
+	}
+}
+
+std::string profiler_report() {
+	std::string report;
+	char line[128];
+	snprintf( line, sizeof(line), "%-22s %7s %7s %7s %7s", "ms", "p50", "p95", "p99", "max" );
+	report += line;
+	append_zone_report( report, 0, 0 );
+	return report;
+}
@@ -0,0 +1,56 @@
+//
+//  profiler.hpp
+//  Isometric Demo
+//
+//  A small scoped CPU profiler. Zones are timed with PROFILE_SCOPE( "name" ),
+//  can be nested, and their per frame totals are kept in a ring buffer
+//  so the overlay can show percentiles instead of a single frame time.
+//
+
+#ifndef _profiler_hpp_
+#define _profiler_hpp_
+
+#define PROFILER_MAX_ZONES 32
+#define PROFILER_HISTORY_FRAMES 240
+
+struct Profile_Zone {
+	const char* name;
+	int parent; // The zone this one was last nested in, zone 0 is the frame.
+	uint32_t calls;
+	uint64_t frame_ns; // Accumulated over every call in the current frame.
+	uint64_t history[ PROFILER_HISTORY_FRAMES ];
+};
+
+struct Profile_Zone_Stats {
+	double p50_ms;
+	double p95_ms;
+	double p99_ms;
+	double max_ms;
+};
+
+void profiler_begin_frame(); // Also ends the previous frame if it is still open.
+void profiler_end_frame();
+
+int profiler_begin_zone( const char* name ); // Returns the zone index to pass to profiler_end_zone().
+void profiler_end_zone( int zone, uint64_t start_ns );
+
+int profiler_zone_count();
+const Profile_Zone* profiler_get_zone( int zone );
+Profile_Zone_Stats profiler_zone_stats( int zone );
+Profile_Zone_Stats profiler_history_stats( const uint64_t* history, int count ); // 'history' is in nanoseconds.
+
+// One line per zone, indented by nesting depth, with p50/p95/p99/max in milliseconds.
+std::string profiler_report();
+
+struct Profile_Scope {
+	int zone;
+	uint64_t start_ns;
+	Profile_Scope( const char* name ) { zone = profiler_begin_zone( name ); start_ns = get_time_ns(); }
+	~Profile_Scope() { profiler_end_zone( zone, start_ns ); }
+};
+
+#define PROFILE_SCOPE_JOIN2(a, b) a##b
+#define PROFILE_SCOPE_JOIN(a, b) PROFILE_SCOPE_JOIN2(a, b)
+#define PROFILE_SCOPE( name ) Profile_Scope PROFILE_SCOPE_JOIN(profile_scope_, __LINE__)( name )
+
+#endif
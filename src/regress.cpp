@@ -0,0 +1,250 @@
+//
+//  regress.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+
+#include "game.hpp"
+#include "sprite.hpp"
+#include "world.hpp"
+#include "profiler.hpp"
+#include "regress.hpp"
+
+#define REGRESS_FRAMES_PER_CASE 30
+#define REGRESS_MESH_ITERATIONS 3
+
+struct Regress_Case {
+	const char* name;
+	float camera_x;
+	float camera_y;
+	float camera_scale;
+	int cutoff_height; // 0 is the top of the world.
+};
+
+// The top face of the world at cutoff height h is centred around y = -16*h - 1024,
+// so the cut views aim there. Together they cover the surface, ramps, the cave
+// cross sections, lava and a close up of individual tiles.
+static const Regress_Case cases[] = {
+	{ "overview",        0,     -2000, 400, 0 },
+	{ "surface",         0,     -2700, 100, 0 },
+	{ "hillside_ramps",  -1200, -2700, 40,  0 },
+	{ "stone_cut_64",    0,     -2000, 250, 64 },
+	{ "lava_closeup_24", 34,    -1188, 40,  24 },
+	{ "lava_cut_24",     0,     -1350, 250, 24 },
+	{ "closeup_cut_90",  300,   -2450, 30,  90 },
+};
+
+struct Regress_Budget {
+	double frame_p95_ms = 250;
+	double mesh_ms = 600;
+	int pixel_tolerance = 2; // Per channel difference that is still treated as equal.
+	double max_differing_pixels = 0; // Fraction of the frame.
+};
+
+static Regress_Budget load_budget( const char* filename ) {
+	Regress_Budget budget;
+	FILE* file = fopen( filename, "r" );
+	if ( !file ) { printf( "No %s, using the default budgets.\n", filename ); return budget; }
+
+	char line[256];
+	while ( fgets( line, sizeof(line), file ) ) {
+		char key[64];
+		double value;
+		if ( line[0] == '#' || sscanf( line, "%63s %lf", key, &value ) != 2 ) continue;
+		if ( strcmp( key, "frame_p95_ms" ) == 0 ) budget.frame_p95_ms = value;
+		else if ( strcmp( key, "mesh_ms" ) == 0 ) budget.mesh_ms = value;
+		else if ( strcmp( key, "pixel_tolerance" ) == 0 ) budget.pixel_tolerance = (int)value;
+		else if ( strcmp( key, "max_differing_pixels" ) == 0 ) budget.max_differing_pixels = value;
+		else printf( "%s: unknown budget '%s'.\n", filename, key );
+	}
+	fclose( file );
+	return budget;
+}
+
+// Binary PPM ( P6 ), top row first, 3 bytes per pixel.
+static bool write_ppm( const std::string& filename, int width, int height, const std::vector<unsigned char>& rgb ) {
+	FILE* file = fopen( filename.c_str(), "wb" );
+	if ( !file ) { printf( "Unable to write %s.\n", filename.c_str() ); return false; }
+	fprintf( file, "P6\n%d %d\n255\n", width, height );
+	fwrite( rgb.data(), 1, rgb.size(), file );
+	fclose( file );
+	return true;
+}
+
+static bool read_ppm( const std::string& filename, int* width, int* height, std::vector<unsigned char>& rgb ) {
+	FILE* file = fopen( filename.c_str(), "rb" );
+	if ( !file ) return false;
+	int max_value = 0;
+	bool ok = fscanf( file, "P6 %d %d %d", width, height, &max_value ) == 3 && max_value == 255 && fgetc( file ) != EOF;
+	if ( ok ) {
+		rgb.resize( (size_t)*width * *height * 3 );
+		ok = fread( rgb.data(), 1, rgb.size(), file ) == rgb.size();
+	}
+	fclose( file );
+	return ok;
+}
+
+struct Regress_Target {
+	unsigned int fbo = 0;
+	unsigned int color = 0;
+	unsigned int depth = 0;
+};
+
+static void create_target( Regress_Target& target, int width, int height ) {
+	glGenRenderbuffers( 1, &target.color );
+	glBindRenderbuffer( GL_RENDERBUFFER, target.color );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, width, height );
+
+	glGenRenderbuffers( 1, &target.depth );
+	glBindRenderbuffer( GL_RENDERBUFFER, target.depth );
+	glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height );
+
+	glGenFramebuffers( 1, &target.fbo );
+	glBindFramebuffer( GL_FRAMEBUFFER, target.fbo );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color );
+	glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+}
+
+static void destroy_target( Regress_Target& target ) {
+	glDeleteFramebuffers( 1, &target.fbo );
+	glDeleteRenderbuffers( 1, &target.color );
+	glDeleteRenderbuffers( 1, &target.depth );
+}
+
+static void render_target( const Regress_Target& target, int width, int height, std::vector<unsigned char>& rgb ) {
+	glBindFramebuffer( GL_FRAMEBUFFER, target.fbo );
+	glViewport( 0, 0, width, height );
+	glClearColor( 25/255.0f, 25/255.0f, 25/255.0f, 1 );
+	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	render_game_world();
+	glUseProgram( 0 );
+
+	std::vector<unsigned char> pixels( (size_t)width * height * 3 );
+	glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+	glReadPixels( 0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data() );
+	glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+
+	// GL rows start at the bottom.
+	rgb.resize( pixels.size() );
+	for ( int y = 0; y < height; ++y ) memcpy( &rgb[ (size_t)y*width*3 ], &pixels[ (size_t)(height-1-y)*width*3 ], width*3 );
+}
+
+// Returns the number of pixels with a channel further than 'tolerance' from the golden image,
+// and fills 'diff' with those pixels in red over a darkened copy of the frame.
+static int compare_images( const std::vector<unsigned char>& a, const std::vector<unsigned char>& b, int tolerance, int* max_error, std::vector<unsigned char>& diff ) {
+	int differing = 0;
+	*max_error = 0;
+	diff.resize( a.size() );
+	for ( size_t i = 0; i < a.size(); i += 3 ) {
+		int error = 0;
+		for ( int c = 0; c < 3; ++c ) error = std::max( error, abs( (int)a[i+c] - (int)b[i+c] ) );
+		if ( error > *max_error ) *max_error = error;
+		if ( error > tolerance ) { differing++; diff[i] = 255; diff[i+1] = 0; diff[i+2] = 0; }
+		else for ( int c = 0; c < 3; ++c ) diff[i+c] = a[i+c] / 4;
+	}
+	return differing;
+}
+
+int run_regression_suite( bool update_golden ) {
+	const int width = REGRESS_WIDTH;
+	const int height = REGRESS_HEIGHT;
+	Regress_Budget budget = load_budget( REGRESS_BUDGET_FILE );
+	int failures = 0;
+
+	resize_view( width, height, width, height );
+
+	// Meshing has to be timed first, it leaves every layer occluded which is only right at full height.
+	uint64_t best_mesh_ns = 0;
+	for ( int i = 0; i < REGRESS_MESH_ITERATIONS; ++i ) {
+		uint64_t start = get_time_ns();
+		generate_world_mesh();
+		glFinish();
+		uint64_t mesh_ns = get_time_ns() - start;
+		if ( i == 0 || mesh_ns < best_mesh_ns ) best_mesh_ns = mesh_ns;
+	}
+	double mesh_ms = best_mesh_ns / 1000000.0;
+	bool mesh_ok = mesh_ms <= budget.mesh_ms;
+	if ( !mesh_ok ) failures++;
+	printf( "%-16s mesh %.2f ms ( budget %.2f ) %s\n", "world", mesh_ms, budget.mesh_ms, mesh_ok ? "ok" : "FAILED" );
+
+	if ( update_golden ) { mkdir( "regress", 0755 ); mkdir( REGRESS_GOLDEN_DIR, 0755 ); }
+
+	Regress_Target target;
+	create_target( target, width, height );
+
+	for ( const Regress_Case& c : cases ) {
+		set_game_view( c.camera_x, c.camera_y, c.camera_scale, c.cutoff_height ? c.cutoff_height : world.size_y );
+
+		std::vector<unsigned char> frame;
+		render_target( target, width, height, frame );
+
+		std::string golden_path = std::string( REGRESS_GOLDEN_DIR ) + "/" + c.name + ".ppm";
+		std::string image_result;
+		bool image_ok = true;
+		if ( update_golden ) {
+			image_ok = write_ppm( golden_path, width, height, frame );
+			image_result = image_ok ? "updated" : "not written";
+		} else {
+			int golden_width = 0, golden_height = 0;
+			std::vector<unsigned char> golden;
+			if ( !read_ppm( golden_path, &golden_width, &golden_height, golden ) ) {
+				image_ok = false;
+				image_result = "missing golden image";
+			} else if ( golden_width != width || golden_height != height ) {
+				image_ok = false;
+				image_result = "golden image is " + std::to_string( golden_width ) + "x" + std::to_string( golden_height );
+			} else {
+				int max_error = 0;
+				std::vector<unsigned char> diff;
+				int differing = compare_images( frame, golden, budget.pixel_tolerance, &max_error, diff );
+				image_ok = differing <= budget.max_differing_pixels * width * height;
+				char text[96];
+				snprintf( text, sizeof(text), "%d pixels differ, max error %d", differing, max_error );
+				image_result = text;
+				if ( !image_ok ) {
+					mkdir( "regress", 0755 );
+					mkdir( REGRESS_OUTPUT_DIR, 0755 );
+					write_ppm( std::string( REGRESS_OUTPUT_DIR ) + "/" + c.name + ".ppm", width, height, frame );
+					write_ppm( std::string( REGRESS_OUTPUT_DIR ) + "/" + c.name + ".diff.ppm", width, height, diff );
+				}
+			}
+		}
+
+		// The frame time is measured with the whole game loop, as the platform layer runs it.
+		uint64_t frame_ns[ REGRESS_FRAMES_PER_CASE ];
+		set_mouse_position( 0, 0 );
+		set_mouse_state( 0 );
+		set_mouse_scroll_value( 0 );
+		for ( int i = 0; i < REGRESS_FRAMES_PER_CASE; ++i ) {
+			uint64_t start = get_time_ns();
+			input_game();
+			update_game();
+			render_game();
+			glFinish();
+			frame_ns[i] = get_time_ns() - start;
+		}
+		double frame_p95_ms = profiler_history_stats( frame_ns, REGRESS_FRAMES_PER_CASE ).p95_ms;
+		bool frame_ok = frame_p95_ms <= budget.frame_p95_ms;
+
+		if ( !image_ok || !frame_ok ) failures++;
+		printf( "%-16s image %s, frame p95 %.2f ms ( budget %.2f ) %s\n", c.name, image_result.c_str(), frame_p95_ms, budget.frame_p95_ms, image_ok && frame_ok ? "ok" : "FAILED" );
+	}
+
+	destroy_target( target );
+
+	int total = (int)( sizeof(cases)/sizeof(cases[0]) ) + 1;
+	printf( "Regression suite: %d of %d passed.\n", total - failures, total );
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+//
+//  regress.hpp
+//  Isometric Demo
+//
+//  The headless regression suite ( IsoDemo --regress ). It renders a fixed
+//  set of camera positions and cutoff heights of the default world into an
+//  offscreen framebuffer and compares them against the golden images in
+//  regress/golden. It also fails when the frame time or the time to mesh
+//  the world goes over the budgets in regress/budget.txt.
+//
+//  Golden images are binary PPM files so they can be viewed and diffed
+//  with common tools. Failing cases write the frame and a diff image to
+//  regress/out.
+//
+
+#ifndef _regress_hpp_
+#define _regress_hpp_
+
+#define REGRESS_GOLDEN_DIR "regress/golden"
+#define REGRESS_OUTPUT_DIR "regress/out"
+#define REGRESS_BUDGET_FILE "regress/budget.txt"
+#define REGRESS_WIDTH 384
+#define REGRESS_HEIGHT 216
+
+// Needs a current GL context of REGRESS_WIDTH x REGRESS_HEIGHT and init_game() to have run,
+// and must be called before the cutoff height is changed. Returns the process exit code.
+// With 'update_golden' the rendered frames replace the golden images.
+int run_regression_suite( bool update_golden );
+
+#endif
@@ -0,0 +1,132 @@
+//
+//  replay.cpp
+//  Isometric Demo
+//
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "debug.hpp"
+#include "replay.hpp"
+
+enum Input_Frame_Field {
+	FIELD_KEYS = 1 << 0,
+	FIELD_MOUSE_POSITION = 1 << 1,
+	FIELD_MOUSE_STATE = 1 << 2,
+	FIELD_MOUSE_SCROLL = 1 << 3,
+	FIELD_DELTA_TIME = 1 << 4,
+};
+
+struct Replay_Header {
+	uint32_t magic;
+	uint32_t version;
+	float window_width;
+	float window_height;
+};
+
+static bool same_bits( float a, float b ) {
+	return memcmp( &a, &b, sizeof(float) ) == 0;
+}
+
+bool open_input_recording( Input_Recording& rec, const char* filename, float window_width, float window_height ) {
+	close_input_recording( rec );
+	rec.file = fopen( filename, "wb" );
+	if ( !rec.file ) { ERROR( "Unable to open " << filename << " for recording.\n" ); return false; }
+
+	Replay_Header header = { REPLAY_MAGIC, REPLAY_VERSION, window_width, window_height };
+	fwrite( &header, sizeof(header), 1, rec.file );
+
+	rec.replaying = false;
+	rec.previous = Input_Frame();
+	rec.frame_count = 0;
+	rec.window_width = window_width;
+	rec.window_height = window_height;
+	return true;
+}
+
+void write_input_frame( Input_Recording& rec, const Input_Frame& frame ) {
+	if ( !rec.file || rec.replaying ) return;
+
+	// Keys are stored as the list of keys that toggled this frame.
+	uint8_t toggled[256];
+	int toggled_count = 0;
+	for ( int k = 0; k < 256; ++k ) {
+		if ( ((frame.keys[k/8] ^ rec.previous.keys[k/8]) >> (k%8)) & 1 ) toggled[ toggled_count++ ] = (uint8_t)k;
+	}
+
+	uint8_t fields = 0;
+	if ( toggled_count > 0 ) fields |= FIELD_KEYS;
+	if ( !same_bits( frame.mouse_x, rec.previous.mouse_x ) || !same_bits( frame.mouse_y, rec.previous.mouse_y ) ) fields |= FIELD_MOUSE_POSITION;
+	if ( frame.mouse_state != rec.previous.mouse_state ) fields |= FIELD_MOUSE_STATE;
+	if ( !same_bits( frame.mouse_scroll, rec.previous.mouse_scroll ) ) fields |= FIELD_MOUSE_SCROLL;
+	if ( !same_bits( frame.delta_time, rec.previous.delta_time ) ) fields |= FIELD_DELTA_TIME;
+
+	fwrite( &fields, 1, 1, rec.file );
+	if ( fields & FIELD_KEYS ) {
+		// 256 toggles can not happen in one frame in practice, but
+		// the count is stored minus one so that it still fits.
+		uint8_t count = (uint8_t)(toggled_count - 1);
+		fwrite( &count, 1, 1, rec.file );
+		fwrite( toggled, 1, toggled_count, rec.file );
+	}
+	if ( fields & FIELD_MOUSE_POSITION ) { fwrite( &frame.mouse_x, sizeof(float), 1, rec.file ); fwrite( &frame.mouse_y, sizeof(float), 1, rec.file ); }
+	if ( fields & FIELD_MOUSE_STATE ) fwrite( &frame.mouse_state, sizeof(uint32_t), 1, rec.file );
+	if ( fields & FIELD_MOUSE_SCROLL ) fwrite( &frame.mouse_scroll, sizeof(float), 1, rec.file );
+	if ( fields & FIELD_DELTA_TIME ) fwrite( &frame.delta_time, sizeof(float), 1, rec.file );
+
+	rec.previous = frame;
+	rec.frame_count++;
+}
+
+bool open_input_replay( Input_Recording& rec, const char* filename ) {
+	close_input_recording( rec );
+	rec.file = fopen( filename, "rb" );
+	if ( !rec.file ) { ERROR( "Unable to open replay " << filename << ".\n" ); return false; }
+
+	Replay_Header header;
+	if ( fread( &header, sizeof(header), 1, rec.file ) != 1 || header.magic != REPLAY_MAGIC || header.version != REPLAY_VERSION ) {
+		ERROR( filename << " is not a replay file.\n" );
+		close_input_recording( rec );
+		return false;
+	}
+
+	rec.replaying = true;
+	rec.previous = Input_Frame();
+	rec.frame_count = 0;
+	rec.window_width = header.window_width;
+	rec.window_height = header.window_height;
+	return true;
+}
+
+bool read_input_frame( Input_Recording& rec, Input_Frame& frame ) {
+	if ( !rec.file || !rec.replaying ) return false;
+
+	uint8_t fields;
+	if ( fread( &fields, 1, 1, rec.file ) != 1 ) return false;
+
+	frame = rec.previous;
+	bool ok = true;
+	if ( fields & FIELD_KEYS ) {
+		uint8_t count;
+		uint8_t toggled[256];
+		ok = ok && fread( &count, 1, 1, rec.file ) == 1;
+		ok = ok && fread( toggled, 1, count+1, rec.file ) == (size_t)(count+1);
+		for ( int i = 0; ok && i < count+1; ++i ) frame.keys[ toggled[i]/8 ] ^= (uint8_t)( 1 << (toggled[i]%8) );
+	}
+	if ( fields & FIELD_MOUSE_POSITION ) ok = ok && fread( &frame.mouse_x, sizeof(float), 1, rec.file ) == 1 && fread( &frame.mouse_y, sizeof(float), 1, rec.file ) == 1;
+	if ( fields & FIELD_MOUSE_STATE ) ok = ok && fread( &frame.mouse_state, sizeof(uint32_t), 1, rec.file ) == 1;
+	if ( fields & FIELD_MOUSE_SCROLL ) ok = ok && fread( &frame.mouse_scroll, sizeof(float), 1, rec.file ) == 1;
+	if ( fields & FIELD_DELTA_TIME ) ok = ok && fread( &frame.delta_time, sizeof(float), 1, rec.file ) == 1;
+	if ( !ok ) { ERROR( "Replay file is truncated.\n" ); return false; }
+
+	rec.previous = frame;
+	rec.frame_count++;
+	return true;
+}
+
+void close_input_recording( Input_Recording& rec ) {
+	if ( rec.file ) fclose( rec.file );
+	rec.file = nullptr;
+	rec.replaying = false;
+}
@@ -0,0 +1,45 @@
+//
+//  replay.hpp
+//  Isometric Demo
+//
+//  Records the per frame input that the platform layer feeds into the
+//  game, so a session can be replayed exactly for performance runs.
+//
+//  File layout: a header, then one record per frame. Each record starts
+//  with a byte saying which fields changed since the previous frame,
+//  followed by only those fields. Floats are stored as raw bits.
+//
+
+#ifndef _replay_hpp_
+#define _replay_hpp_
+
+#define REPLAY_MAGIC 0x43455249 // "IREC"
+#define REPLAY_VERSION 1
+
+struct Input_Frame {
+	uint8_t keys[32]; // One bit per entry of down_keys.
+	float mouse_x; // The values passed to set_mouse_position(), before any scaling.
+	float mouse_y;
+	uint32_t mouse_state;
+	float mouse_scroll;
+	float delta_time;
+};
+
+struct Input_Recording {
+	FILE* file = nullptr;
+	bool replaying = false;
+	Input_Frame previous = {};
+	uint32_t frame_count = 0;
+	float window_width = 0;
+	float window_height = 0;
+};
+
+bool open_input_recording( Input_Recording& rec, const char* filename, float window_width, float window_height );
+void write_input_frame( Input_Recording& rec, const Input_Frame& frame );
+
+bool open_input_replay( Input_Recording& rec, const char* filename );
+bool read_input_frame( Input_Recording& rec, Input_Frame& frame ); // Returns false at the end of the file.
+
+void close_input_recording( Input_Recording& rec );
+
+#endif
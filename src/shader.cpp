@@ -6,17 +6,25 @@
 //  Copyright © 2015 Xavier Slattery. All rights reserved.
 //
 
-#include <OpenGL/gl3.h>
+#include "platform.hpp"
 #include <glm/glm.hpp>
 
+#include <stdio.h>
 #include <fstream>
 #include <string>
 #include <vector>
+#include <atomic>
 
 #include "debug.hpp"
 #include "shader.hpp"
+#include "trace.hpp"
+#include "startup.hpp"
 
 unsigned int LoadShaders( const char * vertex_file_path, const char * fragment_file_path ) {
+	TRACE_SCOPE( "LoadShaders" );
+	STARTUP_PHASE( "LoadShaders" );
+	trace_arg( "vertex", vertex_file_path );
+	trace_arg( "fragment", fragment_file_path );
     
     int Result = 0;
     int InfoLogLength;
@@ -1,16 +1,24 @@
-#include <OpenGL/gl3.h>
+#include "platform.hpp"
 #include <glm/glm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
 #include <vector>
+#include <string>
+#include <atomic>
 
 #include "debug.hpp"
 #include "sprite.hpp"
 #include "shader.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+#include "startup.hpp"
 
 void LoadTexture( unsigned int* tex_id, const char* name ) {
+	TRACE_SCOPE( "LoadTexture" );
+	STARTUP_PHASE( "LoadTexture" );
+	trace_arg( "file", name );
 	int texWidth, texHeight, n;
 	unsigned char* bitmap = stbi_load( name, &texWidth, &texHeight, &n, 4 );
 
@@ -28,6 +36,7 @@ void LoadTexture( unsigned int* tex_id, const char* name ) {
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
 		stbi_image_free( bitmap );
+		memory_track( tex_id, name, 0, (size_t)texWidth * texHeight * 4 );
 	} else {
 		ERROR( "Failed to load image.\n" );
 	}
@@ -252,6 +261,14 @@ void pushToColoredSpriteBatch( ColoredSpriteBatch* sb, glm::vec3 pos, glm::vec2
 	sb->vertex_colors.insert( sb->vertex_colors.end(), tmp_color_array, tmp_color_array + 16 );
 }
 
+ColoredSpriteBatch::~ColoredSpriteBatch() {
+	if ( vao != 0 ) glDeleteVertexArrays( 1, &vao );
+	if ( vbo != 0 ) glDeleteBuffers( 1, &vbo );
+	if ( vbo_color != 0 ) glDeleteBuffers( 1, &vbo_color );
+	if ( ebo != 0 ) glDeleteBuffers( 1, &ebo );
+	memory_untrack( this );
+}
+
 void buildColoredSpriteBatch( ColoredSpriteBatch* sb ) {
 	if ( sb->vao == 0 ) glGenVertexArrays( 1, &sb->vao );
 	if ( sb->vbo == 0 ) glGenBuffers( 1, &sb->vbo );
@@ -278,6 +295,11 @@ void buildColoredSpriteBatch( ColoredSpriteBatch* sb ) {
 			glBufferData( GL_ELEMENT_ARRAY_BUFFER, sb->indices.size() * sizeof(unsigned int), sb->indices.data(), GL_DYNAMIC_DRAW );
 	
 	glBindVertexArray( 0 );
+
+	// The vectors are kept after the upload, so their capacity still counts.
+	size_t cpu_bytes = sb->vertices.capacity() * sizeof(GLfloat) + sb->vertex_colors.capacity() + sb->indices.capacity() * sizeof(unsigned int);
+	size_t gpu_bytes = sb->vertices.size() * sizeof(GLfloat) + sb->vertex_colors.size() + sb->indices.size() * sizeof(unsigned int);
+	memory_track( sb, nullptr, cpu_bytes, gpu_bytes );
 }
 
 void renderColoredSpriteBatch( ColoredSpriteBatch* sb ) {
@@ -346,7 +368,18 @@ void pushToTexturedSpriteBatch( TexturedSpriteBatch* sb, glm::vec3 pos, glm::vec
 	sb->vertex_colors.insert( sb->vertex_colors.end(), tmp_color_array, tmp_color_array + 16 );
 }
 
+TexturedSpriteBatch::~TexturedSpriteBatch() {
+	if ( vao != 0 ) glDeleteVertexArrays( 1, &vao );
+	if ( vbo != 0 ) glDeleteBuffers( 1, &vbo );
+	if ( vbo_tex != 0 ) glDeleteBuffers( 1, &vbo_tex );
+	if ( vbo_color != 0 ) glDeleteBuffers( 1, &vbo_color );
+	if ( ebo != 0 ) glDeleteBuffers( 1, &ebo );
+	memory_untrack( this );
+}
+
 void buildTexturedSpriteBatch( TexturedSpriteBatch* sb, unsigned int shaderID ) {
+	TRACE_SCOPE( "buildTexturedSpriteBatch" );
+	trace_arg( "vertices", (int)sb->vertices.size()/3 );
 	if ( sb->vao == 0 ) glGenVertexArrays( 1, &sb->vao );
 	if ( sb->vbo == 0 ) glGenBuffers( 1, &sb->vbo );
 	if ( sb->vbo_tex == 0 ) glGenBuffers( 1, &sb->vbo_tex );
@@ -380,6 +413,10 @@ void buildTexturedSpriteBatch( TexturedSpriteBatch* sb, unsigned int shaderID )
 			glBufferData( GL_ELEMENT_ARRAY_BUFFER, sb->indices.size() * sizeof(unsigned int), sb->indices.data(), GL_DYNAMIC_DRAW );
 	
 	glBindVertexArray( 0 );
+
+	size_t cpu_bytes = ( sb->vertices.capacity() + sb->vertex_tex.capacity() ) * sizeof(float) + sb->vertex_colors.capacity() + sb->indices.capacity() * sizeof(unsigned int);
+	size_t gpu_bytes = ( sb->vertices.size() + sb->vertex_tex.size() ) * sizeof(float) + sb->vertex_colors.size() + sb->indices.size() * sizeof(unsigned int);
+	memory_track( sb, nullptr, cpu_bytes, gpu_bytes );
 }
 
 void renderTexturedSpriteBatch( TexturedSpriteBatch* sb, unsigned int shaderID, unsigned int texID ) {
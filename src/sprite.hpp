@@ -31,12 +31,7 @@ struct ColoredSpriteBatch {
 	std::vector<unsigned int> indices;
 	unsigned int numIndices = 0;
 
-	~ColoredSpriteBatch() {
-		if ( vao != 0 ) glDeleteVertexArrays( 1, &vao );
-		if ( vbo != 0 ) glDeleteBuffers( 1, &vbo );
-		if ( vbo_color != 0 ) glDeleteBuffers( 1, &vbo_color );
-		if ( ebo != 0 ) glDeleteBuffers( 1, &ebo );
-	}
+	~ColoredSpriteBatch();
 };
 
 void prepairColoredSpriteBatchForPush( ColoredSpriteBatch* sb ); // This will clear the batch if it is already made.
@@ -61,13 +56,7 @@ struct TexturedSpriteBatch {
 	std::vector<unsigned int> indices;
 	unsigned int numIndices = 0;
 
-	~TexturedSpriteBatch() {
-		if ( vao != 0 ) glDeleteVertexArrays( 1, &vao );
-		if ( vbo != 0 ) glDeleteBuffers( 1, &vbo );
-		if ( vbo_tex != 0 ) glDeleteBuffers( 1, &vbo_tex );
-		if ( vbo_color != 0 ) glDeleteBuffers( 1, &vbo_color );
-		if ( ebo != 0 ) glDeleteBuffers( 1, &ebo );
-	}
+	~TexturedSpriteBatch();
 };
 
 void prepairTexturedSpriteBatchForPush( TexturedSpriteBatch* sb ); // This will clear the batch if it is already made.
@@ -0,0 +1,140 @@
+//
+//  startup.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "startup.hpp"
+
+struct Startup_Entry {
+	const char* name;
+	int depth;
+	uint64_t start_ns;
+	uint64_t end_ns;
+};
+
+struct Startup_Total {
+	const char* name;
+	int count;
+	uint64_t ns;
+};
+
+bool startup_recording = true;
+
+static uint64_t process_start_ns = 0;
+static uint64_t first_frame_ns = 0;
+static std::vector<Startup_Entry> entries;
+static std::vector<int> open_entries;
+
+void startup_begin() {
+	process_start_ns = get_time_ns();
+}
+
+void startup_begin_phase( const char* name ) {
+	if ( !startup_recording ) return;
+	if ( process_start_ns == 0 ) process_start_ns = get_time_ns();
+	Startup_Entry entry = { name, (int)open_entries.size(), get_time_ns(), 0 };
+	open_entries.push_back( (int)entries.size() );
+	entries.push_back( entry );
+}
+
+void startup_end_phase() {
+	if ( open_entries.empty() ) return;
+	entries[ open_entries.back() ].end_ns = get_time_ns();
+	open_entries.pop_back();
+}
+
+void startup_first_frame() {
+	if ( !startup_recording ) return;
+	first_frame_ns = get_time_ns();
+	if ( process_start_ns == 0 ) process_start_ns = first_frame_ns;
+
+	// Whatever ran after the last phase ( the first input, update and render ) is the first frame.
+	uint64_t last_end = process_start_ns;
+	for ( const Startup_Entry& entry : entries ) if ( entry.depth == 0 && entry.end_ns > last_end ) last_end = entry.end_ns;
+	Startup_Entry frame = { "first frame", 0, last_end, first_frame_ns };
+	entries.push_back( frame );
+
+	startup_recording = false;
+}
+
+bool startup_finished() {
+	return !startup_recording;
+}
+
+double startup_time_to_first_frame_ms() {
+	if ( first_frame_ns == 0 ) return 0;
+	return ( first_frame_ns - process_start_ns ) / 1000000.0;
+}
+
+static double entry_ms( const Startup_Entry& entry ) {
+	return entry.end_ns > entry.start_ns ? ( entry.end_ns - entry.start_ns ) / 1000000.0 : 0;
+}
+
+// Phases nested two or more levels deep are totalled by name, in order of first appearance.
+static std::vector<Startup_Total> startup_totals() {
+	std::vector<Startup_Total> totals;
+	for ( const Startup_Entry& entry : entries ) {
+		if ( entry.depth < 2 ) continue;
+		size_t i = 0;
+		while ( i < totals.size() && strcmp( totals[i].name, entry.name ) != 0 ) i++;
+		if ( i == totals.size() ) { Startup_Total total = { entry.name, 0, 0 }; totals.push_back( total ); }
+		totals[i].count++;
+		totals[i].ns += entry.end_ns > entry.start_ns ? entry.end_ns - entry.start_ns : 0;
+	}
+	return totals;
+}
+
+std::string startup_report() {
+	std::string report;
+	char line[128];
+	snprintf( line, sizeof(line), "%-34s %9s", "startup ms", "time" );
+	report += line;
+
+	uint64_t accounted_ns = 0;
+	for ( const Startup_Entry& entry : entries ) {
+		if ( entry.depth > 1 ) continue;
+		if ( entry.depth == 0 ) accounted_ns += entry.end_ns - entry.start_ns;
+		std::string name = std::string( entry.depth*2 + 2, ' ' ) + entry.name;
+		snprintf( line, sizeof(line), "\n%-34s %9.2f", name.c_str(), entry_ms( entry ) );
+		report += line;
+	}
+
+	if ( first_frame_ns != 0 ) {
+		uint64_t total_ns = first_frame_ns - process_start_ns;
+		snprintf( line, sizeof(line), "\n%-34s %9.2f", "  other", total_ns > accounted_ns ? ( total_ns - accounted_ns ) / 1000000.0 : 0.0 );
+		report += line;
+		snprintf( line, sizeof(line), "\n%-34s %9.2f", "time to first frame", startup_time_to_first_frame_ms() );
+		report += line;
+	}
+
+	std::vector<Startup_Total> totals = startup_totals();
+	if ( !totals.empty() ) report += "\nby kind";
+	for ( const Startup_Total& total : totals ) {
+		std::string name = "  " + std::string( total.name ) + " x" + std::to_string( total.count );
+		snprintf( line, sizeof(line), "\n%-34s %9.2f", name.c_str(), total.ns / 1000000.0 );
+		report += line;
+	}
+	return report;
+}
+
+void write_startup_json( FILE* file ) {
+	fprintf( file, "{\n  \"time_to_first_frame_ms\": %.3f,\n  \"phases\": [", startup_time_to_first_frame_ms() );
+	for ( size_t i = 0; i < entries.size(); ++i ) {
+		const Startup_Entry& entry = entries[i];
+		fprintf( file, "%s\n    { \"name\": \"%s\", \"depth\": %d, \"start_ms\": %.3f, \"duration_ms\": %.3f }", i ? "," : "",
+			entry.name, entry.depth, ( entry.start_ns - process_start_ns ) / 1000000.0, entry_ms( entry ) );
+	}
+	fprintf( file, "\n  ],\n  \"totals\": [" );
+	std::vector<Startup_Total> totals = startup_totals();
+	for ( size_t i = 0; i < totals.size(); ++i ) {
+		fprintf( file, "%s\n    { \"name\": \"%s\", \"count\": %d, \"total_ms\": %.3f }", i ? "," : "", totals[i].name, totals[i].count, totals[i].ns / 1000000.0 );
+	}
+	fprintf( file, "\n  ]\n}\n" );
+}
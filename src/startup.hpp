@@ -0,0 +1,40 @@
+//
+//  startup.hpp
+//  Isometric Demo
+//
+//  Times the phases of a cold start, from the top of main() until the first
+//  frame has been rendered. Phases can be nested: the report lists the top
+//  level phases in order, and totals the nested ones by name ( eg. every
+//  LoadShaders call ) so it is clear where the startup time goes.
+//
+//  Once the first frame is done, STARTUP_PHASE costs a single branch.
+//
+
+#ifndef _startup_hpp_
+#define _startup_hpp_
+
+void startup_begin(); // Call first thing in main().
+void startup_first_frame(); // Call once the first frame has been presented.
+bool startup_finished();
+
+void startup_begin_phase( const char* name );
+void startup_end_phase();
+
+double startup_time_to_first_frame_ms();
+
+std::string startup_report();
+void write_startup_json( FILE* file );
+
+extern bool startup_recording;
+
+struct Startup_Phase {
+	bool active;
+	Startup_Phase( const char* name ) : active( startup_recording ) { if ( active ) startup_begin_phase( name ); }
+	~Startup_Phase() { if ( active ) startup_end_phase(); }
+};
+
+#define STARTUP_PHASE_JOIN2(a, b) a##b
+#define STARTUP_PHASE_JOIN(a, b) STARTUP_PHASE_JOIN2(a, b)
+#define STARTUP_PHASE( name ) Startup_Phase STARTUP_PHASE_JOIN(startup_phase_, __LINE__)( name )
+
+#endif
@@ -6,7 +6,7 @@
 //  Copyright © 2015 Xavier Slattery. All rights reserved.
 //
 
-#include <OpenGL/gl3.h>
+#include "platform.hpp"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 #include <glm/glm.hpp>
@@ -14,13 +14,22 @@
 
 #include <map>
 #include <vector>
+#include <string>
+#include <atomic>
 
 #include "debug.hpp"
 #include "shader.hpp"
 #include "text.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+#include "startup.hpp"
 
 
 void create_packed_glyph_texture( Packed_Glyph_Texture &pgt, const char* filename, FT_Library freeType, unsigned int filter ) {
+	TRACE_SCOPE( "create_packed_glyph_texture" );
+	STARTUP_PHASE( "create_packed_glyph_texture" );
+	trace_arg( "font", filename );
 
 	if ( pgt.fontsize > 200 ) pgt.fontsize = 200; // NOTE: The max size will be 200pixels aka 100pt
 	
@@ -104,10 +113,12 @@ void create_packed_glyph_texture( Packed_Glyph_Texture &pgt, const char* filenam
 	delete [] combinedBitmap;
 
 	pgt.id = tex_id;
+	memory_track( &pgt.id, filename, 0, (size_t)recm_dim * recm_dim );
 
 }
 
 void create_text_mesh( const char* text, Text_Mesh &tm, Packed_Glyph_Texture &pgt, unsigned int shader_id ) {
+	PROFILE_SCOPE( "text_mesh" );
 
 	float scaleFactor = (float)pgt.fontsize / (float)tm.fontsize;
 
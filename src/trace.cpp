@@ -0,0 +1,141 @@
+//
+//  trace.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+
+#include "debug.hpp"
+#include "trace.hpp"
+
+struct Trace_Event {
+	const char* name;
+	char phase; // 'B' or 'E'.
+	int thread;
+	uint64_t time_ns;
+	std::string args; // Already formatted as the body of a JSON object.
+};
+
+std::atomic<bool> trace_active( false );
+
+static FILE* trace_file = nullptr;
+static uint64_t trace_start_ns = 0;
+static std::vector<Trace_Event> events;
+static std::mutex events_mutex;
+static std::atomic<int> next_thread( 1 );
+
+// Indices into 'events' of the begin events that are still open on this thread.
+static thread_local std::vector<size_t> open_events;
+static thread_local int thread_id = 0;
+
+static int current_thread() {
+	if ( thread_id == 0 ) thread_id = next_thread++;
+	return thread_id;
+}
+
+static void append_json_string( std::string& out, const char* s ) {
+	out += '"';
+	for ( ; *s; ++s ) {
+		if ( *s == '"' || *s == '\\' ) out += '\\';
+		if ( (unsigned char)*s < 0x20 ) { out += ' '; continue; }
+		out += *s;
+	}
+	out += '"';
+}
+
+bool trace_start( const char* filename ) {
+	trace_stop();
+	trace_file = fopen( filename, "w" );
+	if ( !trace_file ) { ERROR( "Unable to open " << filename << " for tracing.\n" ); return false; }
+
+	events.clear();
+	events.reserve( 1 << 16 );
+	open_events.clear();
+	trace_start_ns = get_time_ns();
+	trace_active.store( true, std::memory_order_relaxed );
+	return true;
+}
+
+void trace_stop() {
+	if ( !trace_file ) return;
+
+	std::lock_guard<std::mutex> lock( events_mutex );
+	trace_active.store( false, std::memory_order_relaxed );
+
+	// Events that are still open ( eg. the current frame ) are closed at the time of the stop.
+	uint64_t stop_ns = get_time_ns();
+	std::vector<int> open_depth( next_thread, 0 );
+	for ( size_t i = 0; i < events.size(); ++i ) open_depth[ events[i].thread ] += events[i].phase == 'B' ? 1 : -1;
+
+	fprintf( trace_file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	fprintf( trace_file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"IsoDemo\"}},\n" );
+	fprintf( trace_file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"main\"}}" );
+
+	std::string line;
+	for ( size_t i = 0; i < events.size(); ++i ) {
+		const Trace_Event& e = events[i];
+		line = ",\n{\"name\":";
+		append_json_string( line, e.name );
+		char fields[96];
+		snprintf( fields, sizeof(fields), ",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", e.phase, e.thread, ( e.time_ns - trace_start_ns ) / 1000.0 );
+		line += fields;
+		if ( !e.args.empty() ) line += ",\"args\":{" + e.args + "}";
+		line += "}";
+		fputs( line.c_str(), trace_file );
+	}
+	for ( int thread = 1; thread < (int)open_depth.size(); ++thread ) {
+		for ( int i = 0; i < open_depth[thread]; ++i ) {
+			fprintf( trace_file, ",\n{\"ph\":\"E\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}", thread, ( stop_ns - trace_start_ns ) / 1000.0 );
+		}
+	}
+	fprintf( trace_file, "\n]}\n" );
+
+	fclose( trace_file );
+	trace_file = nullptr;
+	events.clear();
+	open_events.clear();
+	events.shrink_to_fit();
+}
+
+void trace_begin( const char* name ) {
+	if ( !trace_enabled() ) return;
+	Trace_Event e = { name, 'B', current_thread(), get_time_ns() };
+	std::lock_guard<std::mutex> lock( events_mutex );
+	open_events.push_back( events.size() );
+	events.push_back( e );
+}
+
+void trace_end( const char* name ) {
+	// An end without a matching begin happens when tracing started inside the scope.
+	if ( !trace_enabled() || open_events.empty() ) return;
+	Trace_Event e = { name, 'E', current_thread(), get_time_ns() };
+	std::lock_guard<std::mutex> lock( events_mutex );
+	open_events.pop_back();
+	events.push_back( e );
+}
+
+static void append_arg( const char* name, const std::string& value ) {
+	if ( !trace_enabled() || open_events.empty() ) return;
+	std::lock_guard<std::mutex> lock( events_mutex );
+	std::string& args = events[ open_events.back() ].args;
+	if ( !args.empty() ) args += ',';
+	append_json_string( args, name );
+	args += ':';
+	args += value;
+}
+
+void trace_arg( const char* name, int value ) {
+	append_arg( name, std::to_string( value ) );
+}
+
+void trace_arg( const char* name, const char* value ) {
+	std::string quoted;
+	append_json_string( quoted, value );
+	append_arg( name, quoted );
+}
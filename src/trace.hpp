@@ -0,0 +1,42 @@
+//
+//  trace.hpp
+//  Isometric Demo
+//
+//  An opt-in timeline tracer. Between trace_start() and trace_stop() every
+//  begin/end pair is kept in memory, then written out in the Chrome trace
+//  event format, which chrome://tracing and ui.perfetto.dev can open.
+//
+//  Profiler zones ( PROFILE_SCOPE ) are traced automatically, TRACE_SCOPE
+//  is for code that should show up on the timeline but not in the overlay.
+//  Event names must be string literals, only argument values are copied.
+//
+
+#ifndef _trace_hpp_
+#define _trace_hpp_
+
+bool trace_start( const char* filename );
+void trace_stop(); // Writes the file. Also safe to call when no trace was started.
+
+// Read by the job threads too, so it is atomic. A relaxed load is enough: events are
+// recorded under a lock, this only decides whether to try.
+extern std::atomic<bool> trace_active;
+inline bool trace_enabled() { return trace_active.load( std::memory_order_relaxed ); }
+
+void trace_begin( const char* name );
+void trace_end( const char* name );
+
+// Attaches an argument to the innermost open event on this thread.
+void trace_arg( const char* name, int value );
+void trace_arg( const char* name, const char* value );
+
+struct Trace_Scope {
+	const char* name;
+	Trace_Scope( const char* name ) : name( name ) { if ( trace_enabled() ) trace_begin( name ); }
+	~Trace_Scope() { if ( trace_enabled() ) trace_end( name ); }
+};
+
+#define TRACE_SCOPE_JOIN2(a, b) a##b
+#define TRACE_SCOPE_JOIN(a, b) TRACE_SCOPE_JOIN2(a, b)
+#define TRACE_SCOPE( name ) Trace_Scope TRACE_SCOPE_JOIN(trace_scope_, __LINE__)( name )
+
+#endif
@@ -0,0 +1,873 @@
+//
+//  world.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <memory>
+#include <functional>
+#include <atomic>
+
+#include "sprite.hpp"
+#include "noise.hpp"
+#include "world.hpp"
+#include "columns.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+
+World world;
+World_Generator_Params world_generator;
+
+static void track_world_tiles() {
+	memory_track_cpu( &world.chunks, "world tiles", world.tile_bytes );
+	world.tracked_tile_bytes = world.tile_bytes;
+}
+
+// Sets every row of the planes to 'tile', with the bits past the end of the row set to the outside value.
+static void reset_world_planes( Tile tile ) {
+	int used_bits = world.size_x % 64;
+	uint64_t padding = used_bits ? ~0ULL << used_bits : 0;
+	for ( int p = 0; p < WORLD_PLANES; ++p ) {
+		uint64_t word = ( world_plane_types[p] >> tile_type( tile ) ) & 1 ? ~0ULL : 0;
+		std::vector<uint64_t>& plane = world.planes[p];
+		plane.assign( (size_t)world.size_y * world.size_z * world.plane_words, word );
+		if ( !padding ) continue;
+		for ( size_t row = world.plane_words-1; row < plane.size(); row += world.plane_words ) {
+			plane[row] = ( word & ~padding ) | ( world_plane_outside[p] & padding );
+		}
+	}
+}
+
+static void set_plane_bits( int y, int z, int x, Tile tile ) {
+	size_t index = ( (size_t)y * world.size_z + z ) * world.plane_words + ( x >> 6 );
+	uint64_t bit = 1ULL << ( x & 63 );
+	for ( int p = 0; p < WORLD_PLANES; ++p ) {
+		if ( ( world_plane_types[p] >> tile_type( tile ) ) & 1 ) world.planes[p][index] |= bit;
+		else world.planes[p][index] &= ~bit;
+	}
+}
+
+// The planes a tile is in, bit p for plane p.
+static uint8_t tile_plane_mask( Tile tile ) {
+	uint8_t mask = 0;
+	for ( int p = 0; p < WORLD_PLANES; ++p ) mask |= ( ( world_plane_types[p] >> tile_type( tile ) ) & 1 ) << p;
+	return mask;
+}
+
+// The bits of bytes that are 0 or 1, byte i going to bit i.
+static uint64_t gather_byte_bits( uint64_t bytes ) {
+	return ( bytes * 0x0102040810204080ULL ) >> 56;
+}
+
+// The bits each plane has for the 16 tiles of every row of the chunk, [y][z][plane]. The plane
+// masks of the tiles are worked out first, once per palette entry for a palette chunk, and put
+// in [y][z][x] order, so each row's bits are gathered 8 tiles at a time.
+static void chunk_plane_rows( const Chunk& chunk, uint16_t rows[CHUNK_SIZE*CHUNK_SIZE][WORLD_PLANES] ) {
+	if ( !chunk.data ) {
+		uint8_t mask = tile_plane_mask( chunk.uniform );
+		for ( int p = 0; p < WORLD_PLANES; ++p ) rows[0][p] = ( ( mask >> p ) & 1 ) ? 0xFFFF : 0;
+		for ( int r = 1; r < CHUNK_SIZE*CHUNK_SIZE; ++r ) memcpy( rows[r], rows[0], sizeof(rows[0]) );
+		return;
+	}
+
+	const Chunk_Data& data = *chunk.data;
+	uint8_t masks[CHUNK_TILES]; // [y][z][x]
+	if ( !data.indices.empty() ) {
+		uint8_t palette_masks[CHUNK_MAX_PALETTE];
+		for ( size_t p = 0; p < data.palette.size(); ++p ) palette_masks[p] = tile_plane_mask( data.palette[p] );
+		int bits = data.index_bits;
+		uint64_t index_mask = ( 1ULL << bits ) - 1;
+		for ( int i = 0; i < CHUNK_TILES; ++i ) {
+			int bit = chunk_tile_index( world.layout, i >> ( 2*CHUNK_BITS ), i >> CHUNK_BITS, i ) * bits;
+			masks[i] = palette_masks[ ( data.indices[bit >> 6] >> ( bit & 63 ) ) & index_mask ];
+		}
+	} else {
+		for ( int i = 0; i < CHUNK_TILES; ++i ) masks[i] = tile_plane_mask( data.tiles[ chunk_tile_index( world.layout, i >> ( 2*CHUNK_BITS ), i >> CHUNK_BITS, i ) ] );
+	}
+
+	for ( int r = 0; r < CHUNK_SIZE*CHUNK_SIZE; ++r ) {
+		uint64_t low, high;
+		memcpy( &low, masks + r*CHUNK_SIZE, 8 );
+		memcpy( &high, masks + r*CHUNK_SIZE + 8, 8 );
+		for ( int p = 0; p < WORLD_PLANES; ++p ) {
+			rows[r][p] = (uint16_t)( gather_byte_bits( ( low >> p ) & 0x0101010101010101ULL ) | ( gather_byte_bits( ( high >> p ) & 0x0101010101010101ULL ) << 8 ) );
+		}
+	}
+}
+
+// Rewrites the 16 bits of every row of the chunk that starts at ( y, z, x ).
+static void update_chunk_planes( int y, int z, int x ) {
+	uint16_t rows[CHUNK_SIZE*CHUNK_SIZE][WORLD_PLANES];
+	chunk_plane_rows( world_chunk( y, z, x ), rows );
+	int shift = x & 63;
+	for ( int r = 0; r < CHUNK_SIZE*CHUNK_SIZE; ++r ) {
+		size_t index = ( (size_t)( y + ( r >> CHUNK_BITS ) ) * world.size_z + z + ( r & CHUNK_MASK ) ) * world.plane_words + ( x >> 6 );
+		for ( int p = 0; p < WORLD_PLANES; ++p ) {
+			world.planes[p][index] = ( world.planes[p][index] & ~( 0xFFFFULL << shift ) ) | ( (uint64_t)rows[r][p] << shift );
+		}
+	}
+}
+
+static size_t chunk_data_bytes( const Chunk_Data& data ) {
+	return sizeof(Chunk_Data) + data.tiles.capacity() * sizeof(Tile) + data.palette.capacity() * sizeof(Tile) + data.indices.capacity() * sizeof(uint64_t);
+}
+
+static size_t chunk_bytes( const Chunk& chunk ) {
+	return sizeof(Chunk) + ( chunk.data ? chunk_data_bytes( *chunk.data ) : 0 );
+}
+
+// Before the world lets go of a chunk's data: if a snapshot shares it, the snapshots are left holding it on their own.
+static void release_chunk_data( Chunk& chunk ) {
+	if ( chunk.data && chunk.data.use_count() > 1 ) world.snapshot_data_bytes += chunk_data_bytes( *chunk.data );
+}
+
+size_t world_tile_bytes() {
+	return world.tile_bytes;
+}
+
+static void count_world_tile_bytes() {
+	world.tile_bytes = 0;
+	for ( const Chunk& chunk : world.chunks ) world.tile_bytes += chunk_bytes( chunk );
+}
+
+void recount_world_tiles() {
+	count_world_tile_bytes();
+	track_world_tiles();
+}
+
+// Marks the tiles in the box ( inclusive ) as changed. A tile's sprites depend on its six
+// neighbours, so the layers above and below get the box too, and every layer's rect is grown by a tile.
+static void mark_world_dirty( int y0, int z0, int x0, int y1, int z1, int x1 ) {
+	for ( int cy = y0 >> CHUNK_BITS; cy <= y1 >> CHUNK_BITS; ++cy ) {
+		for ( int cz = z0 >> CHUNK_BITS; cz <= z1 >> CHUNK_BITS; ++cz ) {
+			for ( int cx = x0 >> CHUNK_BITS; cx <= x1 >> CHUNK_BITS; ++cx ) {
+				uint8_t& dirty = world.dirty_chunks[ ( (size_t)cy * world.chunks_z + cz ) * world.chunks_x + cx ];
+				if ( !dirty ) { dirty = 1; world.dirty_chunk_count++; }
+			}
+		}
+	}
+
+	int min_x = std::max( x0-1, 0 ), max_x = std::min( x1+1, world.size_x-1 );
+	int min_z = std::max( z0-1, 0 ), max_z = std::min( z1+1, world.size_z-1 );
+	for ( int y = std::max( y0-1, 0 ); y <= std::min( y1+1, world.size_y-1 ); ++y ) {
+		World_Dirty_Rect& rect = world.dirty_layers[y];
+		if ( rect.min_x > rect.max_x ) {
+			rect.min_x = min_x; rect.min_z = min_z; rect.max_x = max_x; rect.max_z = max_z;
+		} else {
+			rect.min_x = std::min( rect.min_x, min_x ); rect.min_z = std::min( rect.min_z, min_z );
+			rect.max_x = std::max( rect.max_x, max_x ); rect.max_z = std::max( rect.max_z, max_z );
+		}
+	}
+}
+
+static void mark_world_chunk_dirty( int y, int z, int x ) {
+	y &= ~CHUNK_MASK; z &= ~CHUNK_MASK; x &= ~CHUNK_MASK;
+	mark_world_dirty( y, z, x, y + CHUNK_MASK, z + CHUNK_MASK, x + CHUNK_MASK );
+}
+
+void clear_world_dirty_layers() {
+	World_Dirty_Rect clean = { 0, 0, -1, -1 };
+	world.dirty_layers.assign( world.size_y, clean );
+}
+
+void clear_world_dirty_chunks() {
+	world.dirty_chunks.assign( world.chunks.size(), 0 );
+	world.dirty_chunk_count = 0;
+}
+
+size_t world_plane_bytes() {
+	size_t bytes = 0;
+	for ( int p = 0; p < WORLD_PLANES; ++p ) bytes += world.planes[p].size() * sizeof(uint64_t);
+	return bytes;
+}
+
+void create_world( int size_x, int size_y, int size_z, Chunk_Layout layout ) {
+	world.layout = layout;
+	world.chunks_x = ( std::max( size_x, 1 ) + CHUNK_MASK ) / CHUNK_SIZE;
+	world.chunks_z = ( std::max( size_z, 1 ) + CHUNK_MASK ) / CHUNK_SIZE;
+	world.chunks_y = ( std::max( size_y, 1 ) + CHUNK_MASK ) / CHUNK_SIZE;
+	world.size_x = world.chunks_x * CHUNK_SIZE;
+	world.size_z = world.chunks_z * CHUNK_SIZE;
+	world.size_y = world.chunks_y * CHUNK_SIZE;
+
+	clear_world_columns();
+	std::vector<int16_t>().swap( world.heightmap );
+	memory_track_cpu( &world.heightmap, "world heightmap", 0 );
+	for ( Chunk& chunk : world.chunks ) release_chunk_data( chunk );
+	std::vector<Chunk>( (size_t)world.chunks_x * world.chunks_z * world.chunks_y ).swap( world.chunks );
+	world.edited_chunks.clear();
+	count_world_tile_bytes();
+	track_world_tiles();
+
+	// Nothing of the new world has been meshed or saved.
+	clear_world_dirty_layers();
+	clear_world_dirty_chunks();
+	mark_world_dirty( 0, 0, 0, world.size_y-1, world.size_z-1, world.size_x-1 );
+
+	world.plane_words = ( world.size_x + 63 ) / 64;
+	reset_world_planes( Tile() );
+	memory_track_cpu( &world.planes, "world planes", world_plane_bytes() );
+
+	delete[] world.tile_sb;
+	world.tile_sb = new TexturedSpriteBatch[world.size_y];
+	world.generated_full_sb.assign( world.size_y, false );
+}
+
+static void set_chunk_index( Chunk_Data& data, int index, int value ) {
+	int bit = index * data.index_bits;
+	uint64_t mask = ( ( 1ULL << data.index_bits ) - 1 ) << ( bit & 63 );
+	data.indices[bit >> 6] = ( data.indices[bit >> 6] & ~mask ) | ( (uint64_t)value << ( bit & 63 ) );
+}
+
+// Re-packs the indices of a palette chunk with 'bits' bits each.
+static void repack_chunk( Chunk_Data& data, int bits ) {
+	std::vector<uint64_t> old_indices;
+	old_indices.swap( data.indices );
+	int old_bits = data.index_bits;
+
+	data.index_bits = (uint8_t)bits;
+	data.indices.assign( CHUNK_TILES * bits / 64, 0 );
+	for ( int i = 0; i < CHUNK_TILES; ++i ) {
+		int bit = i * old_bits;
+		set_chunk_index( data, i, (int)( ( old_indices[bit >> 6] >> ( bit & 63 ) ) & ( ( 1u << old_bits ) - 1 ) ) );
+	}
+}
+
+// Picks the smallest encoding for the chunk's tiles: uniform, a palette with 1, 2 or 4 bit indices, or dense.
+// The chunk always gets new data, so snapshots sharing the old data keep it as it was.
+static void encode_chunk_tiles( Chunk& chunk, std::vector<Tile>& tiles ) {
+	int palette_index[256];
+	for ( int i = 0; i < 256; ++i ) palette_index[i] = -1;
+	std::vector<Tile> palette;
+	for ( int i = 0; i < CHUNK_TILES && palette.size() <= CHUNK_MAX_PALETTE; ++i ) {
+		if ( palette_index[ tiles[i].bits ] >= 0 ) continue;
+		palette_index[ tiles[i].bits ] = (int)palette.size();
+		palette.push_back( tiles[i] );
+	}
+
+	chunk.data.reset();
+	if ( palette.size() == 1 ) {
+		chunk.uniform = tiles[0];
+	} else if ( palette.size() > CHUNK_MAX_PALETTE ) {
+		chunk.data = std::make_shared<Chunk_Data>();
+		chunk.data->tiles.swap( tiles );
+	} else {
+		chunk.data = std::make_shared<Chunk_Data>();
+		Chunk_Data& data = *chunk.data;
+		int bits = palette.size() <= 2 ? 1 : palette.size() <= 4 ? 2 : 4;
+		data.palette.swap( palette );
+		data.index_bits = (uint8_t)bits;
+		data.indices.assign( CHUNK_TILES * bits / 64, 0 );
+		for ( int i = 0; i < CHUNK_TILES; ++i ) set_chunk_index( data, i, palette_index[ tiles[i].bits ] );
+	}
+}
+
+static void encode_chunk( Chunk& chunk, std::vector<Tile>& tiles ) {
+	release_chunk_data( chunk );
+	world.tile_bytes -= chunk_bytes( chunk );
+	encode_chunk_tiles( chunk, tiles );
+	world.tile_bytes += chunk_bytes( chunk );
+}
+
+void set_world_tile( int y, int z, int x, Tile tile ) {
+	Chunk& chunk = world_chunk( y, z, x );
+	int index = chunk_tile_index( world.layout, y, z, x );
+	if ( chunk_tile( chunk, index ).bits == tile.bits ) return;
+
+	world.tile_bytes -= chunk_bytes( chunk );
+	if ( !chunk.data ) {
+		// A uniform chunk becomes a palette of its tile and the new one.
+		chunk.data = std::make_shared<Chunk_Data>();
+		chunk.data->palette.assign( 1, chunk.uniform );
+		chunk.data->index_bits = 1;
+		chunk.data->indices.assign( CHUNK_TILES / 64, 0 );
+	} else if ( chunk.data.use_count() > 1 ) {
+		// Shared with a snapshot, so the chunk gets a copy of its own.
+		release_chunk_data( chunk );
+		chunk.data = std::make_shared<Chunk_Data>( *chunk.data );
+	}
+	Chunk_Data& data = *chunk.data;
+
+	if ( !data.tiles.empty() ) {
+		data.tiles[index] = tile;
+	} else {
+		int value = 0;
+		while ( value < (int)data.palette.size() && data.palette[value].bits != tile.bits ) value++;
+		if ( value == CHUNK_MAX_PALETTE ) {
+			// Too many different tiles for a palette.
+			std::vector<Tile> tiles( CHUNK_TILES );
+			for ( int i = 0; i < CHUNK_TILES; ++i ) tiles[i] = chunk_tile( chunk, i );
+			tiles[index] = tile;
+			data = Chunk_Data();
+			data.tiles.swap( tiles );
+		} else {
+			if ( value == (int)data.palette.size() ) {
+				data.palette.push_back( tile );
+				if ( data.palette.size() > ( 1u << data.index_bits ) ) repack_chunk( data, data.index_bits * 2 );
+			}
+			set_chunk_index( data, index, value );
+		}
+	}
+
+	size_t bytes = chunk_bytes( chunk );
+	world.tile_bytes += bytes;
+	if ( world.tile_bytes != world.tracked_tile_bytes ) track_world_tiles();
+	set_plane_bits( y, z, x, tile );
+	update_world_column( z, x );
+	mark_world_dirty( y, z, x, y, z, x );
+
+	uint32_t chunk_index = (uint32_t)( &chunk - world.chunks.data() );
+	if ( world.edited_chunks.empty() || world.edited_chunks.back() != chunk_index ) world.edited_chunks.push_back( chunk_index );
+}
+
+void set_world_chunk( int y, int z, int x, std::vector<Tile>& tiles ) {
+	encode_chunk( world_chunk( y, z, x ), tiles );
+	update_chunk_planes( y & ~CHUNK_MASK, z & ~CHUNK_MASK, x & ~CHUNK_MASK );
+	track_world_tiles();
+	mark_world_chunk_dirty( y, z, x );
+}
+
+void fill_world( Tile tile ) {
+	for ( Chunk& chunk : world.chunks ) {
+		release_chunk_data( chunk );
+		chunk.data.reset();
+		chunk.uniform = tile;
+	}
+	world.edited_chunks.clear();
+	count_world_tile_bytes();
+	track_world_tiles();
+	reset_world_planes( tile );
+	mark_world_dirty( 0, 0, 0, world.size_y-1, world.size_z-1, world.size_x-1 );
+}
+
+void compact_world() {
+	if ( world.edited_chunks.empty() ) return;
+	std::sort( world.edited_chunks.begin(), world.edited_chunks.end() );
+	world.edited_chunks.erase( std::unique( world.edited_chunks.begin(), world.edited_chunks.end() ), world.edited_chunks.end() );
+
+	std::vector<Tile> tiles;
+	for ( uint32_t index : world.edited_chunks ) {
+		Chunk& chunk = world.chunks[index];
+		if ( !chunk.data ) continue;
+		tiles.resize( CHUNK_TILES );
+		for ( int i = 0; i < CHUNK_TILES; ++i ) tiles[i] = chunk_tile( chunk, i );
+		encode_chunk( chunk, tiles );
+	}
+	world.edited_chunks.clear();
+	if ( world.tile_bytes != world.tracked_tile_bytes ) track_world_tiles();
+}
+
+World_Snapshot snapshot_world() {
+	World_Snapshot snapshot;
+	snapshot.size_x = world.size_x;
+	snapshot.size_z = world.size_z;
+	snapshot.size_y = world.size_y;
+	snapshot.layout = world.layout;
+	snapshot.chunks = world.chunks;
+	return snapshot;
+}
+
+Tile get_snapshot_tile( const World_Snapshot& snapshot, int y, int z, int x ) {
+	int chunks_x = snapshot.size_x / CHUNK_SIZE;
+	int chunks_z = snapshot.size_z / CHUNK_SIZE;
+	const Chunk& chunk = snapshot.chunks[ ( (size_t)( y >> CHUNK_BITS ) * chunks_z + ( z >> CHUNK_BITS ) ) * chunks_x + ( x >> CHUNK_BITS ) ];
+	return chunk_tile( chunk, chunk_tile_index( snapshot.layout, y, z, x ) );
+}
+
+void release_world_snapshot( World_Snapshot& snapshot ) {
+	for ( const Chunk& chunk : snapshot.chunks ) {
+		if ( !chunk.data || chunk.data.use_count() > 1 ) continue;
+		world.snapshot_data_bytes -= std::min( world.snapshot_data_bytes, chunk_data_bytes( *chunk.data ) );
+	}
+	std::vector<Chunk>().swap( snapshot.chunks );
+}
+
+size_t world_snapshot_bytes( const std::vector<World_Snapshot>& snapshots ) {
+	size_t bytes = world.snapshot_data_bytes;
+	for ( const World_Snapshot& snapshot : snapshots ) bytes += snapshot.chunks.capacity() * sizeof(Chunk);
+	return bytes;
+}
+
+void restore_world_snapshot( const World_Snapshot& snapshot ) {
+	TRACE_SCOPE( "restore_world_snapshot" );
+
+	if ( snapshot.size_x != world.size_x || snapshot.size_y != world.size_y || snapshot.size_z != world.size_z || snapshot.layout != world.layout ) {
+		create_world( snapshot.size_x, snapshot.size_y, snapshot.size_z, snapshot.layout );
+	}
+
+	// Only the chunks that changed since the snapshot need their planes redone.
+	for ( int cy = 0; cy < world.chunks_y; ++cy ) {
+		for ( int cz = 0; cz < world.chunks_z; ++cz ) {
+			for ( int cx = 0; cx < world.chunks_x; ++cx ) {
+				size_t i = ( (size_t)cy * world.chunks_z + cz ) * world.chunks_x + cx;
+				Chunk& chunk = world.chunks[i];
+				const Chunk& saved = snapshot.chunks[i];
+				if ( chunk.data == saved.data && ( chunk.data || chunk.uniform.bits == saved.uniform.bits ) ) continue;
+				// The snapshot's data goes back to being the world's.
+				release_chunk_data( chunk );
+				if ( saved.data ) world.snapshot_data_bytes -= std::min( world.snapshot_data_bytes, chunk_data_bytes( *saved.data ) );
+				chunk = saved;
+				update_chunk_planes( cy*CHUNK_SIZE, cz*CHUNK_SIZE, cx*CHUNK_SIZE );
+				mark_world_chunk_dirty( cy*CHUNK_SIZE, cz*CHUNK_SIZE, cx*CHUNK_SIZE );
+			}
+		}
+	}
+	count_world_tile_bytes();
+	track_world_tiles();
+	clear_world_columns();
+}
+
+// The generation passes are split into jobs ( see jobs.hpp ) that each own a strip of chunks
+// 64 tiles wide, which is one word of every plane row, so no two jobs write the same chunk or
+// plane word. The jobs only store the chunks, the pass does what all of them share afterwards.
+#define CHUNKS_PER_WORD ( 64 / CHUNK_SIZE )
+
+static size_t world_chunk_index( int cy, int cz, int cx ) {
+	return ( (size_t)cy * world.chunks_z + cz ) * world.chunks_x + cx;
+}
+
+static void read_chunk_tiles( const Chunk& chunk, std::vector<Tile>& tiles ) {
+	tiles.resize( CHUNK_TILES );
+	for ( int i = 0; i < CHUNK_TILES; ++i ) tiles[i] = chunk_tile( chunk, i );
+}
+
+// set_world_chunk() without the byte count, memory tracking and dirty flags.
+static void store_world_chunk( int cy, int cz, int cx, std::vector<Tile>& tiles ) {
+	encode_chunk_tiles( world.chunks[ world_chunk_index( cy, cz, cx ) ], tiles );
+	update_chunk_planes( cy*CHUNK_SIZE, cz*CHUNK_SIZE, cx*CHUNK_SIZE );
+}
+
+// After the jobs of a pass have stored the chunks flagged in 'changed'.
+static void finish_world_pass( const std::vector<uint8_t>& changed ) {
+	for ( int cy = 0; cy < world.chunks_y; ++cy ) {
+		for ( int cz = 0; cz < world.chunks_z; ++cz ) {
+			for ( int cx = 0; cx < world.chunks_x; ++cx ) {
+				if ( changed[ world_chunk_index( cy, cz, cx ) ] ) mark_world_chunk_dirty( cy*CHUNK_SIZE, cz*CHUNK_SIZE, cx*CHUNK_SIZE );
+			}
+		}
+	}
+	recount_world_tiles();
+	clear_world_columns();
+}
+
+// A job per strip of chunks, the same strips as the generation passes. The rows of the chunks
+// in a strip make whole plane words, so each word is written once, keeping its padding bits.
+void rebuild_world_planes() {
+	TRACE_SCOPE( "rebuild_world_planes" );
+	run_jobs( world.chunks_z * world.plane_words, [&]( int job ) {
+		int cz = job / world.plane_words;
+		int w = job % world.plane_words;
+		int first_cx = w*CHUNKS_PER_WORD;
+		int end_cx = std::min( first_cx + CHUNKS_PER_WORD, world.chunks_x );
+		uint64_t used = end_cx*CHUNK_SIZE - w*64 >= 64 ? ~0ULL : ( 1ULL << ( end_cx*CHUNK_SIZE - w*64 ) ) - 1;
+
+		uint16_t rows[CHUNKS_PER_WORD][CHUNK_SIZE*CHUNK_SIZE][WORLD_PLANES];
+		for ( int cy = 0; cy < world.chunks_y; ++cy ) {
+			for ( int cx = first_cx; cx < end_cx; ++cx ) chunk_plane_rows( world.chunks[ world_chunk_index( cy, cz, cx ) ], rows[cx - first_cx] );
+			for ( int r = 0; r < CHUNK_SIZE*CHUNK_SIZE; ++r ) {
+				size_t index = ( (size_t)( cy*CHUNK_SIZE + ( r >> CHUNK_BITS ) ) * world.size_z + cz*CHUNK_SIZE + ( r & CHUNK_MASK ) ) * world.plane_words + w;
+				for ( int p = 0; p < WORLD_PLANES; ++p ) {
+					uint64_t word = 0;
+					for ( int cx = first_cx; cx < end_cx; ++cx ) word |= (uint64_t)rows[cx - first_cx][r][p] << ( ( cx - first_cx ) * CHUNK_SIZE );
+					world.planes[p][index] = ( world.planes[p][index] & ~used ) | word;
+				}
+			}
+		}
+	} );
+}
+
+// A job per row of columns. The heights are clamped to the world, which fills the columns the same.
+void generate_world_heightmap() {
+	TRACE_SCOPE( "generate_world_heightmap" );
+
+	if ( world.chunks.empty() ) create_world( WORLD_DEFAULT_SIZE_X, WORLD_DEFAULT_SIZE_Y, WORLD_DEFAULT_SIZE_Z );
+	const World_Generator_Params& params = world_generator;
+	set_noise_seed( params.seed );
+	world.heightmap.resize( (size_t)world.size_z * world.size_x );
+	Fractal_Noise heights = make_fractal_noise( FRACTAL_NOISE_2D, params.height_octaves, params.height_scale, params.height_persistence, params.height_lacunarity );
+	run_jobs( world.size_z, [&]( int z ) {
+		std::vector<float> xx( world.size_x ), noise( world.size_x );
+		for (int x = 0; x < world.size_x; ++x) xx[x] = x;
+		fractal_noise_row( heights, xx.data(), world.size_z-z, 0, noise.data(), world.size_x );
+		for (int x = 0; x < world.size_x; ++x) {
+			float power = (float)exp( noise[x] );
+			int height = (int)( power * params.height_amplitude ) + params.height_base;
+			world.heightmap[ (size_t)z * world.size_x + x ] = (int16_t)std::min( std::max( height, -1 ), world.size_y );
+		}
+	} );
+	world.heightmap_params = params;
+	memory_track_cpu( &world.heightmap, "world heightmap", world.heightmap.capacity() * sizeof(int16_t) );
+}
+
+bool world_heightmap_current() {
+	return world.heightmap.size() == (size_t)world.size_z * world.size_x && memcmp( &world.heightmap_params, &world_generator, sizeof(World_Generator_Params) ) == 0;
+}
+
+// Generated a chunk at a time from the heightmap, so the air and stone chunks never get an array.
+// A job is a strip of chunk columns.
+void generate_world_terrain() {
+	TRACE_SCOPE( "generate_world_terrain" );
+
+	if ( world.chunks.empty() ) create_world( WORLD_DEFAULT_SIZE_X, WORLD_DEFAULT_SIZE_Y, WORLD_DEFAULT_SIZE_Z );
+	if ( !world_heightmap_current() ) generate_world_heightmap();
+	clear_world_columns();
+	fill_world( Tile() );
+
+	run_jobs( world.chunks_z * world.plane_words, [&]( int job ) {
+		TRACE_SCOPE( "terrain_strip" );
+		int cz = job / world.plane_words;
+		int w = job % world.plane_words;
+
+		std::vector<Tile> tiles;
+		for (int cx = w*CHUNKS_PER_WORD; cx < std::min( (w+1)*CHUNKS_PER_WORD, world.chunks_x ); ++cx) {
+			for (int cy = 0; cy < world.chunks_y; ++cy) {
+				tiles.resize( CHUNK_TILES );
+				for (int y = 0; y < CHUNK_SIZE; ++y) {
+					for (int z = 0; z < CHUNK_SIZE; ++z) {
+						for (int x = 0; x < CHUNK_SIZE; ++x) {
+
+							int height = get_world_height( cz*CHUNK_SIZE + z, cx*CHUNK_SIZE + x );
+							int wy = cy*CHUNK_SIZE + y;
+							Tile tile;
+							if ( height > wy ) {
+								tile = make_tile( STONE );
+							}
+							else if ( height == wy ) {
+								tile = make_tile( DIRT );
+							}
+							tiles[ chunk_tile_index( world.layout, y, z, x ) ] = tile;
+
+						}
+					}
+				}
+				store_world_chunk( cy, cz, cx, tiles );
+			}
+		}
+	} );
+
+	recount_world_tiles();
+}
+
+// A job is a strip of chunks in one layer of chunks. Lava only goes up to
+// cave_max_y, so the chunks above it have no noise to evaluate. A point only
+// takes the octaves it needs to tell whether it is below the threshold.
+void generate_world_caves() {
+	TRACE_SCOPE( "generate_world_caves" );
+
+	const World_Generator_Params& params = world_generator;
+	set_noise_seed( params.seed );
+	Fractal_Noise caves = make_fractal_noise( FRACTAL_SIMPLEX, params.cave_octaves, params.cave_scale, 1, 2 );
+	const Tile lava = make_tile( LAVA );
+	int chunks_y = params.cave_max_y < 0 ? 0 : std::min( world.chunks_y, ( params.cave_max_y >> CHUNK_BITS ) + 1 );
+	int strips = world.chunks_z * world.plane_words;
+	std::vector<uint8_t> changed( world.chunks.size(), 0 );
+	run_jobs( chunks_y * strips, [&]( int job ) {
+		TRACE_SCOPE( "caves_strip" );
+		int cy = job / strips;
+		int cz = job % strips / world.plane_words;
+		int w = job % world.plane_words;
+
+		std::vector<Tile> tiles;
+		float xs[CHUNK_SIZE];
+		uint8_t below[CHUNK_SIZE];
+		for (int cx = w*CHUNKS_PER_WORD; cx < std::min( (w+1)*CHUNKS_PER_WORD, world.chunks_x ); ++cx) {
+			read_chunk_tiles( world.chunks[ world_chunk_index( cy, cz, cx ) ], tiles );
+			for (int x = 0; x < CHUNK_SIZE; ++x) xs[x] = cx*CHUNK_SIZE + x;
+			bool written = false;
+			for (int y = cy*CHUNK_SIZE; y < std::min( (cy+1)*CHUNK_SIZE, params.cave_max_y+1 ); ++y) {
+				for (int z = cz*CHUNK_SIZE; z < (cz+1)*CHUNK_SIZE; ++z) {
+					fractal_noise_below_row( caves, xs, y, z, params.cave_threshold, below, CHUNK_SIZE );
+					for (int x = cx*CHUNK_SIZE; x < (cx+1)*CHUNK_SIZE; ++x) {
+
+						Tile& tile = tiles[ chunk_tile_index( world.layout, y, z, x ) ];
+						if ( below[ x - cx*CHUNK_SIZE ] && tile.bits != lava.bits ) {
+							tile = lava;
+							written = true;
+						}
+
+					}
+				}
+			}
+			if ( written ) {
+				store_world_chunk( cy, cz, cx, tiles );
+				changed[ world_chunk_index( cy, cz, cx ) ] = 1;
+			}
+		}
+	} );
+
+	finish_world_pass( changed );
+}
+
+// The direction of a ramp from which of its four sides have a full tile next to them.
+static Direction ramp_direction( bool xp, bool xn, bool zp, bool zn ) {
+	if ( xp && zp && xn ) 		{ return ZP; }
+	else if ( xp && zp && zn ) 	{ return XP; }
+	else if ( xn && zp && zn ) 	{ return XN; }
+	else if ( xp && zn && xn ) 	{ return ZN; }
+	else if ( xp && zp ) 		{ return XP_ZP; }
+	else if ( xn && zn ) 		{ return XN_ZN; }
+	else if ( xn && zp ) 		{ return XN_ZP; }
+	else if ( xp && zn ) 		{ return XP_ZN; }
+	else if ( xp ) 				{ return XP; }
+	else if ( zp ) 				{ return ZP; }
+	else if ( xn ) 				{ return XN; }
+	else if ( zn ) 				{ return ZN; }
+	return NONE;
+}
+
+// A ramp goes on air that has air above it, a tile other than a ramp below it,
+// and dirt on at least one side. The planes test 64 tiles of a row at a time.
+// Ramps don't change the outcome for the tiles around them: next to a ramp reads
+// the same as next to air, and a ramp below a tile is skipped like air. So the
+// jobs first find every ramp from the planes as they were before the pass, reading
+// the rows around their own freely since nothing is written yet, then write them.
+struct Ramp_Tile {
+	int y;
+	int z;
+	int x;
+	Tile tile;
+};
+
+void generate_world_ramps() {
+	TRACE_SCOPE( "generate_world_ramps" );
+
+	Direction directions[16];
+	for ( int i = 0; i < 16; ++i ) directions[i] = ramp_direction( i & 1, i & 2, i & 4, i & 8 );
+
+	// A job is the rows of one word in a chunk, and writes the chunks of that word.
+	int strips = world.chunks_z * world.plane_words;
+	std::vector< std::vector<Ramp_Tile> > ramps( world.chunks_y * strips );
+	run_jobs( (int)ramps.size(), [&]( int job ) {
+		TRACE_SCOPE( "ramps_find" );
+		int cy = job / strips;
+		int cz = job % strips / world.plane_words;
+		int w = job % world.plane_words;
+
+		for (int y = cy*CHUNK_SIZE; y < (cy+1)*CHUNK_SIZE; ++y) {
+			for (int z = cz*CHUNK_SIZE; z < (cz+1)*CHUNK_SIZE; ++z) {
+
+				uint64_t candidates = world_plane_word( PLANE_AIR, y, z, w ) & world_plane_word( PLANE_AIR, y+1, z, w ) & ~world_plane_word( PLANE_AIR, y-1, z, w ) & ~world_plane_word( PLANE_RAMP, y-1, z, w );
+				if ( !candidates ) continue;
+				candidates &= world_plane_word_xp( PLANE_DIRT, y, z, w ) | world_plane_word_xn( PLANE_DIRT, y, z, w ) | world_plane_word( PLANE_DIRT, y, z+1, w ) | world_plane_word( PLANE_DIRT, y, z-1, w );
+
+				uint64_t full_xp = world_plane_word_xp( PLANE_FULL, y, z, w );
+				uint64_t full_xn = world_plane_word_xn( PLANE_FULL, y, z, w );
+				uint64_t full_zp = world_plane_word( PLANE_FULL, y, z+1, w );
+				uint64_t full_zn = world_plane_word( PLANE_FULL, y, z-1, w );
+				while ( candidates ) {
+					int bit = __builtin_ctzll( candidates );
+					candidates &= candidates - 1;
+					int sides = ( ( full_xp >> bit ) & 1 ) | ( ( ( full_xn >> bit ) & 1 ) << 1 ) | ( ( ( full_zp >> bit ) & 1 ) << 2 ) | ( ( ( full_zn >> bit ) & 1 ) << 3 );
+					Ramp_Tile ramp = { y, z, w*64 + bit, make_tile( DIRT_RAMP, directions[sides] ) };
+					ramps[job].push_back( ramp );
+				}
+
+			}
+		}
+	} );
+
+	std::vector<uint8_t> changed( world.chunks.size(), 0 );
+	run_jobs( (int)ramps.size(), [&]( int job ) {
+		if ( ramps[job].empty() ) return;
+		TRACE_SCOPE( "ramps_write" );
+		int cy = job / strips;
+		int cz = job % strips / world.plane_words;
+		int w = job % world.plane_words;
+
+		std::vector<Tile> tiles;
+		for (int cx = w*CHUNKS_PER_WORD; cx < std::min( (w+1)*CHUNKS_PER_WORD, world.chunks_x ); ++cx) {
+			bool written = false;
+			for ( const Ramp_Tile& ramp : ramps[job] ) {
+				if ( ramp.x >> CHUNK_BITS != cx ) continue;
+				if ( !written ) read_chunk_tiles( world.chunks[ world_chunk_index( cy, cz, cx ) ], tiles );
+				tiles[ chunk_tile_index( world.layout, ramp.y, ramp.z, ramp.x ) ] = ramp.tile;
+				written = true;
+			}
+			if ( written ) {
+				store_world_chunk( cy, cz, cx, tiles );
+				changed[ world_chunk_index( cy, cz, cx ) ] = 1;
+			}
+		}
+	} );
+
+	finish_world_pass( changed );
+}
+
+// Every pass stores the chunks it writes in their smallest encoding, so there is nothing to compact.
+void generate_world() {
+	TRACE_SCOPE( "generate_world" );
+	generate_world_terrain();
+	generate_world_caves();
+	generate_world_ramps();
+}
+
+void classify_world_layer ( int layer, bool occlude, std::vector<Tile_Quad>& quads ) {
+
+	auto push_quad = [&]( glm::vec3 position, glm::vec4 texcoord ) {
+		Tile_Quad quad = { position, texcoord };
+		quads.push_back( quad );
+	};
+
+	glm::vec2 x_vector = glm::vec2(0.5f, -0.25f);
+	glm::vec2 z_vector = glm::vec2(-0.5f, -0.25f);
+	glm::vec2 y_vector = glm::vec2(0, -1);
+
+	// The neighbour tests are done for 64 tiles of a row at once with the planes,
+	// then the tiles that have a sprite are visited one by one.
+	int y = layer;
+	for (int z = 0; z < world.size_z; ++z) {
+		for (int w = 0; w < world.plane_words; ++w) {
+
+			uint64_t air = world_plane_word( PLANE_AIR, y, z, w );
+			uint64_t visible = ~air;
+
+			// This is testing to see if we can skip rendering this
+			// tile because it is obstructed by other tiles.
+			if ( occlude ) {
+				uint64_t solid_xn = ~world_plane_word_xn( PLANE_AIR, y, z, w ) & ~world_plane_word_xn( PLANE_RAMP, y, z, w );
+				uint64_t solid_zn = ~world_plane_word( PLANE_AIR, y, z-1, w ) & ~world_plane_word( PLANE_RAMP, y, z-1, w );
+				uint64_t covered = ~world_plane_word( PLANE_AIR, y+1, z, w );
+				visible &= ~( solid_xn & solid_zn & covered );
+			}
+			if ( !visible ) continue;
+
+			uint64_t empty_xp = world_plane_word_xp( PLANE_AIR, y, z, w );
+			uint64_t empty_xn = world_plane_word_xn( PLANE_AIR, y, z, w );
+			uint64_t empty_zp = world_plane_word( PLANE_AIR, y, z+1, w );
+			uint64_t empty_zn = world_plane_word( PLANE_AIR, y, z-1, w );
+			uint64_t empty_yn = world_plane_word( PLANE_AIR, y-1, z, w );
+			uint64_t ramp_xp = world_plane_word_xp( PLANE_RAMP, y, z, w );
+			uint64_t ramp_xn = world_plane_word_xn( PLANE_RAMP, y, z, w );
+			uint64_t ramp_zp = world_plane_word( PLANE_RAMP, y, z+1, w );
+			uint64_t ramp_zn = world_plane_word( PLANE_RAMP, y, z-1, w );
+
+			// Tiles with no air or lava around them, and no ramps beside them, are drawn dark.
+			uint64_t open = world_plane_word( PLANE_AIR_OR_LAVA, y+1, z, w ) | world_plane_word( PLANE_AIR_OR_LAVA, y-1, z, w ) |
+				world_plane_word( PLANE_AIR_OR_LAVA, y, z+1, w ) | ramp_zp | world_plane_word( PLANE_AIR_OR_LAVA, y, z-1, w ) | ramp_zn |
+				world_plane_word_xp( PLANE_AIR_OR_LAVA, y, z, w ) | ramp_xp | world_plane_word_xn( PLANE_AIR_OR_LAVA, y, z, w ) | ramp_xn;
+			uint64_t dark = ~open;
+
+			while ( visible ) {
+				int bit = __builtin_ctzll( visible );
+				visible &= visible - 1;
+				int x = w*64 + bit;
+				Tile tile = get_world_tile( y, z, x );
+
+				glm::vec2 loc = (float)x*x_vector*32.0f + (float)z*z_vector*32.0f + (float)y*y_vector*16.0f;
+				glm::vec4 tex = glm::vec4(0, 0, 1.0f, 1.0f);
+
+				switch ( tile_type( tile ) ) {
+					case AIR: continue; break;
+					case DIRT: tex = glm::vec4(0, 0, 0.125f, 0.125f); break;
+					case DIRT_RAMP: {
+						switch ( tile_direction( tile ) ) {
+							case XP_ZP: tex = glm::vec4(0.625f, 0.0f, 0.750f, 0.125f); break;
+							case XN_ZN: tex = glm::vec4(0.875f, 0.125f, 1.000f, 0.250f); break;
+							case XP_ZN: tex = glm::vec4(0.750f, 0.125f, 0.875f, 0.250f); break;
+							case XN_ZP: tex = glm::vec4(0.625f, 0.125f, 0.750f, 0.250f); break;
+						
+							// case XP: tex = glm::vec4(0.125f, 0.500f, 0.250f, 0.625f); break;
+							// case ZP: tex = glm::vec4(0.250f, 0.500f, 0.375f, 0.625f); break;
+							// case ZN: tex = glm::vec4(0.375f, 0.500f, 0.500f, 0.625f); break;
+							// case XN: tex = glm::vec4(0.500f, 0.500f, 0.625f, 0.625f); break;
+							case XP: tex = glm::vec4(0.375f, 0.0f, 0.500f, 0.125f); break;
+							case ZP: tex = glm::vec4(0.500f, 0.0f, 0.625f, 0.125f); break;
+							case XN: tex = glm::vec4(0.875f, 0.0f, 1.000f, 0.125f); break;
+							case ZN: tex = glm::vec4(0.750f, 0.0f, 0.875f, 0.125f); break;
+							default: break;
+						}
+					} break;
+					case WOOD_RAMP: {
+						switch ( tile_direction( tile ) ) {
+							case XP: tex = glm::vec4(0.375f, 0.0f, 0.500f, 0.125f); break;
+							case ZP: tex = glm::vec4(0.500f, 0.0f, 0.625f, 0.125f); break;
+							case XN: tex = glm::vec4(0.875f, 0.0f, 1.000f, 0.125f); break;
+							case ZN: tex = glm::vec4(0.750f, 0.0f, 0.875f, 0.125f); break;
+							default: break;
+						}
+					} break;
+					case STONE: tex = glm::vec4(0, 0.250f, 0.125f, 0.375f); break;
+					case WOOD: tex = glm::vec4(0, 0.500f, 0.125f, 0.625f); break;
+					case LAVA: tex = glm::vec4(0.000f, 0.750f, 0.125f, 0.875f); break;
+					default: tex = glm::vec4(0, 0, 1.0f, 1.0f); break;
+				}
+
+				if ( ( dark >> bit ) & 1 ) tex = glm::vec4( 0.875f, 0.875f, 1.0f, 1.0f );
+
+				push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 ), tex );
+
+				if ( tile_is_full( tile ) ) {
+					if ( ( ( empty_xp | ramp_xp ) >> bit ) & 1 ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.250f ,0.0f, 0.375f, 0.125f) ); }
+					if ( ( ( empty_zp | ramp_zp ) >> bit ) & 1 ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.125f, 0.0f, 0.250f, 0.125f) ); }
+					if ( ( empty_yn >> bit ) & 1 ) {
+						push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.625f, 0.375f, 0.750f, 0.500f) );
+						push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.750f, 0.375f, 0.875f, 0.500f) );
+					}
+				}
+
+				if ( tile_is_ramp( tile ) ) {
+					Direction direction = tile_direction( tile );
+					if 		( direction == XP_ZP ) { }
+					else if ( direction == XN_ZN ) { }
+					else if ( direction == XP_ZN ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.375f, 0.375f, 0.500f, 0.500f) ); }
+					else if ( direction == XN_ZP ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.500f, 0.375f, 0.625f, 0.500f) ); }
+					else if ( direction == XP && ( ( empty_zp >> bit ) & 1 ) ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.375f, 0.125f, 0.500f, 0.250f) ); }
+					else if ( direction == ZP && ( ( empty_xp >> bit ) & 1 ) ) { push_quad( glm::vec3(loc.x, loc.y, -(x + z) + y*2 + 0.1f ), glm::vec4(0.500f, 0.125f, 0.625f, 0.250f) ); }
+					else if ( direction == XN && ( ( empty_zn >> bit ) & 1 ) ) { }
+					else if ( direction == ZN && ( ( empty_xn >> bit ) & 1 ) ) { }
+				}
+
+			}
+
+		}
+	}
+}
+
+void emit_world_layer ( TexturedSpriteBatch* sb, const std::vector<Tile_Quad>& quads ) {
+	for ( size_t i = 0; i < quads.size(); ++i ) {
+		pushToTexturedSpriteBatch( sb, quads[i].position, glm::vec2(1), 0, glm::vec2(32, 32), glm::vec2(0.5f, 1.0f), quads[i].texcoord, 1.0f );
+	}
+}
+
+void mesh_world_layer ( int layer, bool occlude ) {
+
+	world.generated_full_sb[layer] = !occlude;
+	World_Dirty_Rect clean = { 0, 0, -1, -1 };
+	world.dirty_layers[layer] = clean;
+
+	static std::vector<Tile_Quad> quads;
+	quads.clear();
+	classify_world_layer( layer, occlude, quads );
+
+	prepairTexturedSpriteBatchForPush( &world.tile_sb[layer] );
+	emit_world_layer( &world.tile_sb[layer], quads );
+}
+
+void generate_world_mesh_layer ( int layer, bool occlude ) {
+	PROFILE_SCOPE( "mesh_layer" );
+	trace_arg( "layer", layer );
+	mesh_world_layer( layer, occlude );
+
+	char name[32];
+	snprintf( name, sizeof(name), "world layer %d", layer );
+	memory_name( &world.tile_sb[layer], name );
+	buildTexturedSpriteBatch( &world.tile_sb[layer], world.shaderID );
+}
+
+void generate_world_mesh () {
+	TRACE_SCOPE( "generate_world_mesh" );
+
+	for (int y = 0; y < world.size_y; ++y) {
+		generate_world_mesh_layer(y, true);
+	}
+
+}
@@ -0,0 +1,298 @@
+//
+//  world.hpp
+//  Isometric Demo
+//
+//  The tile data of the world and the functions that generate it.
+//
+
+#ifndef _world_hpp_
+#define _world_hpp_
+
+enum Tile_Type {
+	AIR = 0,
+
+	DIRT = 1,
+	DIRT_RAMP = 2,
+
+	STONE = 3,
+
+	WOOD = 4,
+	WOOD_RAMP = 5,
+
+	LAVA = 6,
+};
+
+enum Direction {
+	NONE = 0,
+	XP = 1,
+	XN = 2,
+	ZP = 3,
+	ZN = 4,
+
+	XP_ZP = 5,
+	XN_ZN = 6,
+	XP_ZN = 7,
+	XN_ZP = 8,
+};
+
+// A tile is packed into a single byte: the type in the low 3 bits and the
+// direction in the 4 bits above it. Whether a tile is full or a ramp only
+// depends on its type, so those are looked up from the type instead of stored.
+struct Tile {
+	uint8_t bits = 0; // AIR, NONE
+};
+
+#define TILE_TYPE_BITS 3
+#define TILE_TYPE_MASK 0x07
+
+// One bit per Tile_Type.
+#define TILE_FULL_TYPES ( (1 << DIRT) | (1 << STONE) | (1 << WOOD) )
+#define TILE_RAMP_TYPES ( (1 << DIRT_RAMP) | (1 << WOOD_RAMP) )
+
+inline Tile make_tile( Tile_Type type, Direction direction = NONE ) {
+	Tile tile;
+	tile.bits = (uint8_t)( type | ( direction << TILE_TYPE_BITS ) );
+	return tile;
+}
+
+inline Tile_Type tile_type( Tile tile ) { return (Tile_Type)( tile.bits & TILE_TYPE_MASK ); }
+inline Direction tile_direction( Tile tile ) { return (Direction)( tile.bits >> TILE_TYPE_BITS ); }
+inline bool tile_is_full( Tile tile ) { return ( TILE_FULL_TYPES >> ( tile.bits & TILE_TYPE_MASK ) ) & 1; }
+inline bool tile_is_ramp( Tile tile ) { return ( TILE_RAMP_TYPES >> ( tile.bits & TILE_TYPE_MASK ) ) & 1; }
+
+// The tiles are stored in chunks of 16x16x16, in one of three encodings:
+// - uniform: the chunk is the same tile throughout ( the air above the terrain,
+//   the stone under it ) and only stores that tile.
+// - palette: up to 16 distinct tiles, and a 1, 2 or 4 bit index into them per tile.
+//   Writing a new tile adds it to the palette and re-packs the indices when they run out of bits.
+// - dense: a byte per tile, once a chunk has more distinct tiles than a palette holds.
+// A uniform chunk becomes a palette chunk the first time a different tile is written to it.
+#define CHUNK_BITS 4
+#define CHUNK_SIZE ( 1 << CHUNK_BITS )
+#define CHUNK_MASK ( CHUNK_SIZE - 1 )
+#define CHUNK_TILES ( CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE )
+#define CHUNK_MAX_PALETTE 16
+
+// The tiles of a palette or dense chunk. Shared between the world and its snapshots
+// until the world writes to the chunk, which then gets a copy of its own.
+struct Chunk_Data {
+	std::vector<Tile> tiles; // Dense: CHUNK_TILES tiles, see chunk_tile_index().
+	std::vector<Tile> palette; // Palette: the distinct tiles,
+	std::vector<uint64_t> indices; // and the index into 'palette' of every tile, packed 'index_bits' each.
+	uint8_t index_bits = 0;
+};
+
+struct Chunk {
+	Tile uniform; // Every tile of the chunk while it has no data.
+	std::shared_ptr<Chunk_Data> data;
+};
+
+inline Tile chunk_tile( const Chunk& chunk, int index ) {
+	const Chunk_Data* data = chunk.data.get();
+	if ( !data ) return chunk.uniform;
+	if ( !data->indices.empty() ) {
+		int bit = index * data->index_bits;
+		return data->palette[ ( data->indices[bit >> 6] >> ( bit & 63 ) ) & ( ( 1u << data->index_bits ) - 1 ) ];
+	}
+	return data->tiles[index];
+}
+
+// The order of the tiles inside a chunk. Linear is [y][z][x], so a y neighbour is 256 tiles away.
+// Morton interleaves the bits of x, z and y ( in that order ), which keeps all six neighbours
+// of most tiles within the same few cache lines.
+enum Chunk_Layout {
+	CHUNK_LINEAR = 0,
+	CHUNK_MORTON = 1,
+};
+
+// A 4 bit coordinate with its bits spread 3 apart.
+static const uint16_t chunk_morton_bits[CHUNK_SIZE] = { 0x000, 0x001, 0x008, 0x009, 0x040, 0x041, 0x048, 0x049, 0x200, 0x201, 0x208, 0x209, 0x240, 0x241, 0x248, 0x249 };
+
+inline int chunk_tile_index( Chunk_Layout layout, int y, int z, int x ) {
+	if ( layout == CHUNK_MORTON ) return chunk_morton_bits[x & CHUNK_MASK] | ( chunk_morton_bits[z & CHUNK_MASK] << 1 ) | ( chunk_morton_bits[y & CHUNK_MASK] << 2 );
+	return ( ( y & CHUNK_MASK ) << ( 2*CHUNK_BITS ) ) | ( ( z & CHUNK_MASK ) << CHUNK_BITS ) | ( x & CHUNK_MASK );
+}
+
+// Alongside the tiles, every row along x keeps one bit per tile for each of these planes,
+// so the mesher and the ramp pass can test 64 neighbours at once with shifts and ANDs.
+// Outside the world a plane reads as world_plane_outside, which matches what the per tile
+// checks used to return for coordinates out of bounds.
+enum World_Plane {
+	PLANE_AIR = 0,
+	PLANE_RAMP = 1,
+	PLANE_FULL = 2,
+	PLANE_DIRT = 3,
+	PLANE_AIR_OR_LAVA = 4,
+	WORLD_PLANES = 5,
+};
+
+// The Tile_Types in each plane, one bit per type.
+static const uint8_t world_plane_types[WORLD_PLANES] = { 1 << AIR, TILE_RAMP_TYPES, TILE_FULL_TYPES, 1 << DIRT, (1 << AIR) | (1 << LAVA) };
+static const uint64_t world_plane_outside[WORLD_PLANES] = { ~0ULL, 0, 0, 0, 0 };
+
+// The size of the world when create_world() hasn't been called before generating it.
+#define WORLD_DEFAULT_SIZE_X 128
+#define WORLD_DEFAULT_SIZE_Z 128
+#define WORLD_DEFAULT_SIZE_Y 128
+
+// The constants generate_world() works from. A world file stores them next to
+// the tiles, so a saved world records what it was generated with.
+struct World_Generator_Params {
+	float height_scale = 350; // Heightmap noise: the size of the features in tiles,
+	int height_octaves = 4;
+	float height_persistence = 0.5f;
+	float height_lacunarity = 2.5f;
+	float height_amplitude = 25; // and the height is exp( noise ) * amplitude + base.
+	int height_base = 64;
+	float cave_scale = 32; // Cave noise: lava where the simplex noise is below the threshold,
+	int cave_octaves = 3;
+	float cave_threshold = 2.1f;
+	int cave_max_y = 32; // up to this layer.
+	uint32_t seed = 0; // Shuffles the noise permutation tables, 0 keeps the original ones ( see noise.hpp ).
+};
+
+extern World_Generator_Params world_generator;
+
+// The part of a layer whose mesh is out of date, in tiles. Inclusive, and empty while min_x > max_x.
+struct World_Dirty_Rect {
+	int min_x;
+	int min_z;
+	int max_x;
+	int max_z;
+};
+
+struct World {
+	int size_x = 0;
+	int size_z = 0;
+	int size_y = 0;
+	int chunks_x = 0;
+	int chunks_z = 0;
+	int chunks_y = 0;
+	std::vector<Chunk> chunks; // [y][z][x]
+	size_t tile_bytes = 0; // The memory held by the chunks.
+	size_t tracked_tile_bytes = 0;
+	Chunk_Layout layout = CHUNK_LINEAR;
+
+	// What the edits made through set_world_tile() ( and the other writes below ) have changed.
+	// Meshing a layer clears its rect, saving or loading the world clears the chunks.
+	std::vector<World_Dirty_Rect> dirty_layers; // Per layer, the edited tiles and their neighbours.
+	std::vector<uint8_t> dirty_chunks; // Per chunk, whether its tiles changed since the last save or load.
+	size_t dirty_chunk_count = 0;
+	size_t snapshot_data_bytes = 0; // The chunk data that only snapshots hold, kept up to date as the world lets go of shared data.
+	std::vector<uint32_t> edited_chunks; // The chunks set_world_tile() has changed since the last compact_world(), may repeat.
+
+	// The surface of the generated terrain, the layer of the dirt on top of each column ( -1 for
+	// none ), [z][x]. It is what generation made, edits don't change it ( the columns have the live tops ).
+	// Kept until the size or the generator params change, so regenerating skips the 2D noise.
+	std::vector<int16_t> heightmap;
+	World_Generator_Params heightmap_params;
+
+	int plane_words = 0; // 64 bit words per row.
+	std::vector<uint64_t> planes[WORLD_PLANES]; // [y][z][word], bit x%64 of word x/64.
+
+	// One batch per layer. A plain array since the batches own their GL objects and can't be copied.
+	TexturedSpriteBatch* tile_sb = nullptr;
+	std::vector<bool> generated_full_sb;
+
+	unsigned int shaderID = 0;
+	unsigned int texID = 0;
+};
+
+extern World world;
+
+inline Chunk& world_chunk( int y, int z, int x ) {
+	return world.chunks[ ( (size_t)( y >> CHUNK_BITS ) * world.chunks_z + ( z >> CHUNK_BITS ) ) * world.chunks_x + ( x >> CHUNK_BITS ) ];
+}
+
+inline int get_world_height( int z, int x ) {
+	return world.heightmap[ (size_t)z * world.size_x + x ];
+}
+
+// The coordinates have to be inside the world.
+inline Tile get_world_tile( int y, int z, int x ) {
+	return chunk_tile( world_chunk( y, z, x ), chunk_tile_index( world.layout, y, z, x ) );
+}
+
+// Word 'w' of a plane's row, or the outside value when the row is outside the world.
+inline uint64_t world_plane_word( int plane, int y, int z, int w ) {
+	if ( y < 0 || z < 0 || y >= world.size_y || z >= world.size_z ) return world_plane_outside[plane];
+	return world.planes[plane][ ( (size_t)y * world.size_z + z ) * world.plane_words + w ];
+}
+
+// The same word shifted so bit i holds the tile at x+1 ( world_plane_word_xp ) or x-1 ( world_plane_word_xn ).
+inline uint64_t world_plane_word_xp( int plane, int y, int z, int w ) {
+	uint64_t next = w+1 < world.plane_words ? world_plane_word( plane, y, z, w+1 ) : world_plane_outside[plane];
+	return ( world_plane_word( plane, y, z, w ) >> 1 ) | ( next << 63 );
+}
+
+inline uint64_t world_plane_word_xn( int plane, int y, int z, int w ) {
+	uint64_t previous = w > 0 ? world_plane_word( plane, y, z, w-1 ) : world_plane_outside[plane];
+	return ( world_plane_word( plane, y, z, w ) << 1 ) | ( previous >> 63 );
+}
+
+inline bool world_layer_dirty( int layer ) {
+	return world.dirty_layers[layer].min_x <= world.dirty_layers[layer].max_x;
+}
+
+// Sizes are rounded up to a whole number of chunks. Discards the tiles and meshes of the previous world.
+void create_world( int size_x, int size_y, int size_z, Chunk_Layout layout = CHUNK_LINEAR );
+
+// The one way the game edits the world. Keeps the planes and columns up to date, and marks
+// the layers whose meshes the tile shows up in ( its own and the ones above and below ) dirty.
+void set_world_tile( int y, int z, int x, Tile tile );
+// Replaces every tile of the chunk that contains ( y, z, x ) with 'tiles', which are in
+// chunk_tile_index() order. The vector is left with unspecified contents.
+void set_world_chunk( int y, int z, int x, std::vector<Tile>& tiles );
+void fill_world( Tile tile ); // Makes every chunk uniform.
+void compact_world(); // Re-encodes the chunks edited since the last call, eg. shrinks the palettes of chunks that lost tiles.
+size_t world_tile_bytes();
+void recount_world_tiles(); // After filling world.chunks directly, eg. from a world file.
+void rebuild_world_planes(); // Likewise, the planes from the chunks.
+void clear_world_dirty_layers();
+void clear_world_dirty_chunks(); // Once the world has been saved.
+
+// A frozen copy of the tiles ( not the planes, columns or meshes ). Taking one copies the
+// chunk table and shares the chunk data, and the world copies a chunk's data the first time
+// it writes to it afterwards, so a snapshot costs the chunks edited since it was taken.
+struct World_Snapshot {
+	int size_x = 0;
+	int size_z = 0;
+	int size_y = 0;
+	Chunk_Layout layout = CHUNK_LINEAR;
+	std::vector<Chunk> chunks;
+};
+
+World_Snapshot snapshot_world();
+Tile get_snapshot_tile( const World_Snapshot& snapshot, int y, int z, int x );
+// Empties a snapshot that is being dropped. Use it rather than letting the snapshot go, so world.snapshot_data_bytes stays right.
+void release_world_snapshot( World_Snapshot& snapshot );
+size_t world_snapshot_bytes( const std::vector<World_Snapshot>& snapshots ); // Their chunk tables and world.snapshot_data_bytes.
+void restore_world_snapshot( const World_Snapshot& snapshot ); // Undo: puts the tiles back and updates what depends on them.
+size_t world_plane_bytes();
+
+// generate_world() runs the phases below in order.
+// They are exposed separately so they can be timed on their own.
+void generate_world();
+void generate_world_heightmap(); // The 2D stage: the height of every column from the heightmap noise.
+bool world_heightmap_current(); // Whether the heightmap was made for the current size and generator params.
+void generate_world_terrain(); // Fills stone up to the height and caps it with dirt. Makes the heightmap first if it isn't current.
+void generate_world_caves(); // Replaces tiles with lava where the 3D simplex noise is low.
+void generate_world_ramps(); // Places dirt ramps on the air tiles next to the terrain.
+
+// A single 32x32 tile sprite produced by the mesher.
+struct Tile_Quad {
+	glm::vec3 position;
+	glm::vec4 texcoord;
+};
+
+// Meshing is split the same way so it can be timed without a GL context:
+// classify_world_layer() decides which sprites a layer needs ( tile classification ),
+// emit_world_layer() turns them into vertices ( vertex emission ),
+// and generate_world_mesh_layer() also uploads the layer to OpenGL.
+void classify_world_layer( int layer, bool occlude, std::vector<Tile_Quad>& quads );
+void emit_world_layer( TexturedSpriteBatch* sb, const std::vector<Tile_Quad>& quads );
+void mesh_world_layer( int layer, bool occlude );
+void generate_world_mesh_layer( int layer, bool occlude = false );
+void generate_world_mesh();
+
+#endif
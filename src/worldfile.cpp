@@ -0,0 +1,331 @@
+//
+//  worldfile.cpp
+//  Isometric Demo
+//
+
+#include "platform.hpp"
+#include <glm/glm.hpp>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <atomic>
+
+#include "debug.hpp"
+#include "sprite.hpp"
+#include "world.hpp"
+#include "worldfile.hpp"
+#include "trace.hpp"
+#include "memory.hpp"
+
+enum World_File_Encoding {
+	WORLD_FILE_UNIFORM = 0,
+	WORLD_FILE_PALETTE = 1,
+	WORLD_FILE_DENSE = 2,
+};
+
+struct World_File_Header {
+	uint32_t magic;
+	uint32_t version;
+	int32_t size_x;
+	int32_t size_z;
+	int32_t size_y;
+	int32_t layout;
+	World_Generator_Params params;
+	uint64_t chunk_table_offset; // A World_File_Chunk per chunk.
+	uint64_t chunk_data_offset;
+	uint64_t chunk_data_bytes;
+	uint64_t heightmap_offset;
+	uint64_t heightmap_count; // 0 when there was no heightmap.
+	uint64_t file_bytes;
+};
+
+struct World_File_Chunk {
+	uint8_t encoding;
+	uint8_t uniform; // The tile of a uniform chunk.
+	uint8_t index_bits; // Palette chunks: bits per index,
+	uint8_t palette_size; // and the number of palette entries used.
+	uint32_t reserved;
+	uint64_t data_offset; // From the start of the chunk data.
+	uint8_t palette[CHUNK_MAX_PALETTE];
+};
+
+static uint64_t align_offset( uint64_t offset ) {
+	return ( offset + 7 ) & ~7ULL;
+}
+
+static uint64_t chunk_file_bytes( const World_File_Chunk& entry ) {
+	if ( entry.encoding == WORLD_FILE_PALETTE ) return CHUNK_TILES * entry.index_bits / 8;
+	if ( entry.encoding == WORLD_FILE_DENSE ) return CHUNK_TILES;
+	return 0;
+}
+
+static void write_padding( FILE* file, uint64_t* offset ) {
+	static const char zeros[8] = {};
+	uint64_t aligned = align_offset( *offset );
+	fwrite( zeros, 1, aligned - *offset, file );
+	*offset = aligned;
+}
+
+bool save_world_file( const char* filename ) {
+	TRACE_SCOPE( "save_world_file" );
+
+	World_File_Header header = {};
+	header.magic = WORLD_FILE_MAGIC;
+	header.version = WORLD_FILE_VERSION;
+	header.size_x = world.size_x;
+	header.size_z = world.size_z;
+	header.size_y = world.size_y;
+	header.layout = world.layout;
+	header.params = world_generator;
+
+	std::vector<World_File_Chunk> table( world.chunks.size() );
+	uint64_t data_bytes = 0;
+	for ( size_t i = 0; i < world.chunks.size(); ++i ) {
+		const Chunk& chunk = world.chunks[i];
+		World_File_Chunk& entry = table[i];
+		entry = World_File_Chunk();
+		entry.uniform = chunk.uniform.bits;
+		if ( !chunk.data ) {
+			entry.encoding = WORLD_FILE_UNIFORM;
+		} else if ( !chunk.data->indices.empty() ) {
+			entry.encoding = WORLD_FILE_PALETTE;
+			entry.index_bits = chunk.data->index_bits;
+			entry.palette_size = (uint8_t)chunk.data->palette.size();
+			for ( size_t p = 0; p < chunk.data->palette.size(); ++p ) entry.palette[p] = chunk.data->palette[p].bits;
+		} else {
+			entry.encoding = WORLD_FILE_DENSE;
+		}
+		entry.data_offset = data_bytes;
+		data_bytes += chunk_file_bytes( entry );
+	}
+
+	header.chunk_table_offset = align_offset( sizeof(header) );
+	header.chunk_data_offset = align_offset( header.chunk_table_offset + table.size() * sizeof(World_File_Chunk) );
+	header.chunk_data_bytes = data_bytes;
+	header.heightmap_offset = align_offset( header.chunk_data_offset + data_bytes );
+	header.heightmap_count = world_heightmap_current() ? world.heightmap.size() : 0;
+	header.file_bytes = header.heightmap_offset + header.heightmap_count * sizeof(int16_t);
+
+	// Written next to the file and renamed over it, so a failed save leaves the old file alone.
+	std::string temporary = std::string( filename ) + ".tmp";
+	FILE* file = fopen( temporary.c_str(), "wb" );
+	if ( !file ) { ERROR( "Unable to open " << temporary << " for writing.\n" ); return false; }
+
+	uint64_t offset = 0;
+	offset += fwrite( &header, 1, sizeof(header), file );
+	write_padding( file, &offset );
+	offset += fwrite( table.data(), 1, table.size() * sizeof(World_File_Chunk), file );
+	write_padding( file, &offset );
+	for ( const Chunk& chunk : world.chunks ) {
+		if ( !chunk.data ) continue;
+		if ( !chunk.data->indices.empty() ) offset += fwrite( chunk.data->indices.data(), 1, chunk.data->indices.size() * sizeof(uint64_t), file );
+		else offset += fwrite( chunk.data->tiles.data(), 1, chunk.data->tiles.size() * sizeof(Tile), file );
+	}
+	write_padding( file, &offset );
+	offset += fwrite( world.heightmap.data(), 1, header.heightmap_count * sizeof(int16_t), file );
+
+	bool ok = fclose( file ) == 0 && offset == header.file_bytes;
+	if ( ok ) ok = rename( temporary.c_str(), filename ) == 0;
+	if ( !ok ) { ERROR( "Unable to write " << filename << ".\n" ); remove( temporary.c_str() ); }
+	else clear_world_dirty_chunks();
+	return ok;
+}
+
+// Whether every packed index of a palette chunk is inside its palette.
+static bool palette_indices_valid( const World_File_Chunk& entry, const unsigned char* data ) {
+	if ( entry.palette_size == ( 1 << entry.index_bits ) ) return true;
+	unsigned mask = ( 1u << entry.index_bits ) - 1;
+	for ( uint64_t i = 0; i < chunk_file_bytes( entry ); ++i ) {
+		for ( int bit = 0; bit < 8; bit += entry.index_bits ) {
+			if ( ( ( data[i] >> bit ) & mask ) >= entry.palette_size ) return false;
+		}
+	}
+	return true;
+}
+
+// Checks everything the loader relies on before the world is touched.
+static const char* check_world_file( const unsigned char* bytes, uint64_t file_bytes ) {
+	if ( file_bytes < sizeof(World_File_Header) ) return "is too short";
+	const World_File_Header& header = *(const World_File_Header*)bytes;
+	if ( header.magic != WORLD_FILE_MAGIC ) return "is not a world file";
+	if ( header.version != WORLD_FILE_VERSION ) return "is from another version";
+	if ( header.file_bytes != file_bytes ) return "is truncated";
+
+	// Column_Run::top is 16 bits, which limits the height.
+	if ( header.size_x <= 0 || header.size_z <= 0 || header.size_y <= 0 || header.size_y >= 65536 ) return "has a bad world size";
+	if ( ( header.size_x | header.size_z | header.size_y ) & CHUNK_MASK ) return "has a bad world size";
+	if ( header.layout != CHUNK_LINEAR && header.layout != CHUNK_MORTON ) return "has an unknown chunk layout";
+
+	uint64_t chunk_count = (uint64_t)( header.size_x / CHUNK_SIZE ) * ( header.size_z / CHUNK_SIZE ) * ( header.size_y / CHUNK_SIZE );
+	uint64_t columns = (uint64_t)header.size_z * header.size_x;
+	if ( header.heightmap_count != 0 && header.heightmap_count != columns ) return "has a heightmap of the wrong size";
+
+	struct Section { uint64_t offset, bytes; } sections[] = {
+		{ header.chunk_table_offset, chunk_count * sizeof(World_File_Chunk) },
+		{ header.chunk_data_offset, header.chunk_data_bytes },
+		{ header.heightmap_offset, header.heightmap_count * sizeof(int16_t) },
+	};
+	for ( const Section& section : sections ) {
+		if ( section.offset & 7 || section.offset > file_bytes || section.bytes > file_bytes - section.offset ) return "has a section out of bounds";
+	}
+
+	const World_File_Chunk* table = (const World_File_Chunk*)( bytes + header.chunk_table_offset );
+	for ( uint64_t i = 0; i < chunk_count; ++i ) {
+		const World_File_Chunk& entry = table[i];
+		if ( entry.encoding > WORLD_FILE_DENSE ) return "has a chunk with an unknown encoding";
+		if ( entry.encoding == WORLD_FILE_PALETTE ) {
+			if ( entry.index_bits != 1 && entry.index_bits != 2 && entry.index_bits != 4 ) return "has a chunk with bad palette indices";
+			if ( entry.palette_size < 2 || entry.palette_size > ( 1 << entry.index_bits ) ) return "has a chunk with a bad palette";
+		}
+		if ( entry.data_offset > header.chunk_data_bytes || chunk_file_bytes( entry ) > header.chunk_data_bytes - entry.data_offset ) return "has chunk data out of bounds";
+		if ( entry.encoding == WORLD_FILE_PALETTE && !palette_indices_valid( entry, bytes + header.chunk_data_offset + entry.data_offset ) ) return "has a chunk with indices past its palette";
+	}
+	return nullptr;
+}
+
+bool load_world_file( const char* filename ) {
+	TRACE_SCOPE( "load_world_file" );
+
+	FILE* file = fopen( filename, "rb" );
+	if ( !file ) { printf( "No world file %s.\n", filename ); return false; }
+
+	// Every section is copied into the world, so the file is read whole, into words so the sections are aligned.
+	// It is small: the table, the chunks that aren't uniform in their encoded form, and the heightmap.
+	struct stat info;
+	if ( fstat( fileno( file ), &info ) != 0 || info.st_size <= 0 ) { ERROR( "Unable to read " << filename << ".\n" ); fclose( file ); return false; }
+	uint64_t file_bytes = (uint64_t)info.st_size;
+	std::vector<uint64_t> buffer( ( file_bytes + 7 ) / 8 );
+	bool read = fread( buffer.data(), 1, file_bytes, file ) == file_bytes;
+	fclose( file );
+	if ( !read ) { ERROR( "Unable to read " << filename << ".\n" ); return false; }
+	const unsigned char* bytes = (const unsigned char*)buffer.data();
+
+	const char* problem = check_world_file( bytes, file_bytes );
+	if ( problem ) {
+		ERROR( filename << " " << problem << ".\n" );
+		return false;
+	}
+
+	const World_File_Header& header = *(const World_File_Header*)bytes;
+	world_generator = header.params;
+	create_world( header.size_x, header.size_y, header.size_z, (Chunk_Layout)header.layout );
+
+	const World_File_Chunk* table = (const World_File_Chunk*)( bytes + header.chunk_table_offset );
+	const unsigned char* chunk_data = bytes + header.chunk_data_offset;
+	for ( size_t i = 0; i < world.chunks.size(); ++i ) {
+		const World_File_Chunk& entry = table[i];
+		Chunk& chunk = world.chunks[i];
+		chunk.uniform.bits = entry.uniform;
+		if ( entry.encoding == WORLD_FILE_UNIFORM ) continue;
+
+		chunk.data = std::make_shared<Chunk_Data>();
+		Chunk_Data& data = *chunk.data;
+		const unsigned char* source = chunk_data + entry.data_offset;
+		if ( entry.encoding == WORLD_FILE_PALETTE ) {
+			data.index_bits = entry.index_bits;
+			data.palette.resize( entry.palette_size );
+			for ( int p = 0; p < entry.palette_size; ++p ) data.palette[p].bits = entry.palette[p];
+			data.indices.resize( CHUNK_TILES * entry.index_bits / 64 );
+			memcpy( data.indices.data(), source, data.indices.size() * sizeof(uint64_t) );
+		} else {
+			data.tiles.resize( CHUNK_TILES );
+			memcpy( data.tiles.data(), source, CHUNK_TILES * sizeof(Tile) );
+		}
+	}
+	recount_world_tiles();
+	// The planes and columns only restate the chunks, so they aren't in the file. The columns wait for their first query.
+	rebuild_world_planes();
+
+	if ( header.heightmap_count ) {
+		const int16_t* heights = (const int16_t*)( bytes + header.heightmap_offset );
+		world.heightmap.assign( heights, heights + header.heightmap_count );
+		world.heightmap_params = header.params;
+		memory_track_cpu( &world.heightmap, "world heightmap", world.heightmap.capacity() * sizeof(int16_t) );
+	}
+
+	clear_world_dirty_chunks();
+	return true;
+}
+
+bool world_file_exists( const char* filename ) {
+	return access( filename, F_OK ) == 0;
+}
+
+// FNV-1a over everything the generated world depends on, the file and generator versions
+// included so a cache written by an older version is never picked up.
+static uint64_t world_cache_key() {
+	int32_t shape[] = { WORLD_FILE_VERSION, WORLD_GENERATOR_VERSION, world.size_x, world.size_z, world.size_y, world.layout };
+	uint64_t hash = 1469598103934665603ULL;
+	const unsigned char* parts[] = { (const unsigned char*)shape, (const unsigned char*)&world_generator };
+	size_t sizes[] = { sizeof(shape), sizeof(World_Generator_Params) };
+	for ( int part = 0; part < 2; ++part ) {
+		for ( size_t i = 0; i < sizes[part]; ++i ) hash = ( hash ^ parts[part][i] ) * 1099511628211ULL;
+	}
+	return hash;
+}
+
+std::string world_cache_filename( const char* directory ) {
+	char name[32];
+	snprintf( name, sizeof(name), "world-%016llx.world", (unsigned long long)world_cache_key() );
+	return std::string( directory ) + "/" + name;
+}
+
+bool load_cached_world( const char* directory ) {
+	std::string filename = world_cache_filename( directory );
+	if ( access( filename.c_str(), R_OK ) != 0 ) { printf( "No cached world for these generator params.\n" ); return false; }
+
+	// load_world_file() takes the size, layout and params from the file, which
+	// has to match what was asked for, or the hash collided.
+	int size_x = world.size_x, size_y = world.size_y, size_z = world.size_z;
+	Chunk_Layout layout = world.layout;
+	World_Generator_Params params = world_generator;
+	if ( !load_world_file( filename.c_str() ) ) return false;
+	if ( world.size_x == size_x && world.size_y == size_y && world.size_z == size_z && world.layout == layout &&
+		memcmp( &world_generator, &params, sizeof(World_Generator_Params) ) == 0 ) return true;
+
+	ERROR( filename << " holds another world.\n" );
+	world_generator = params;
+	create_world( size_x, size_y, size_z, layout );
+	return false;
+}
+
+// Like mkdir -p, every missing directory on the path is made.
+static bool make_directories( const char* path ) {
+	std::string partial( path );
+	for ( size_t i = 1; i <= partial.size(); ++i ) {
+		if ( i < partial.size() && partial[i] != '/' ) continue;
+		std::string prefix = partial.substr( 0, i );
+		if ( mkdir( prefix.c_str(), 0755 ) != 0 && errno != EEXIST ) return false;
+	}
+	return true;
+}
+
+// Only the world for the current params is kept, any other world-*.world is from earlier
+// params and would never be cleaned up otherwise.
+static void remove_stale_cached_worlds( const char* directory, const std::string& keep ) {
+	DIR* dir = opendir( directory );
+	if ( !dir ) return;
+	while ( dirent* entry = readdir( dir ) ) {
+		size_t length = strlen( entry->d_name );
+		if ( strncmp( entry->d_name, "world-", 6 ) != 0 || length < 12 || strcmp( entry->d_name + length - 6, ".world" ) != 0 ) continue;
+		std::string filename = std::string( directory ) + "/" + entry->d_name;
+		if ( filename != keep ) unlink( filename.c_str() );
+	}
+	closedir( dir );
+}
+
+bool save_cached_world( const char* directory ) {
+	// Not an error, the world is there either way, it just has to be generated again next time.
+	if ( !make_directories( directory ) ) { printf( "Unable to create %s, the world isn't cached.\n", directory ); return false; }
+	std::string filename = world_cache_filename( directory );
+	if ( !save_world_file( filename.c_str() ) ) return false;
+	remove_stale_cached_worlds( directory, filename );
+	return true;
+}
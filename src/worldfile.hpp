@@ -0,0 +1,52 @@
+//
+//  worldfile.hpp
+//  Isometric Demo
+//
+//  Saves the world to a binary file and reads it back in, so a saved map
+//  opens without running generate_world(). The file holds the chunks as they
+//  are encoded in memory, and loading copies them straight into place. What
+//  can be worked out from the chunks is left out and rebuilt: the planes after
+//  loading, the columns on their first query ( see columns.hpp ). The file has:
+//
+//  - a header: magic, version, the world size and chunk layout, the
+//    World_Generator_Params it was generated with, and where each of the
+//    sections below starts,
+//  - the chunk table, one entry per chunk in [y][z][x] order with its
+//    encoding, uniform tile or palette, and the offset of its data,
+//  - the chunk data: the packed palette indices or the dense tiles,
+//  - the heightmap, when there is one.
+//
+//  Sections start on 8 byte boundaries. Everything is stored little endian,
+//  in the byte order of the machines the demo runs on.
+//
+//  The same files make up the world cache: a generated world saved under a
+//  hash of what it was generated from, so the next start with the same size,
+//  layout and World_Generator_Params loads it instead of generating it again.
+//
+
+#ifndef _worldfile_hpp_
+#define _worldfile_hpp_
+
+#define WORLD_FILE_MAGIC 0x574F5349 // "ISOW"
+#define WORLD_FILE_VERSION 4 // 2 added the heightmap, 3 the seed, 4 dropped the planes and columns.
+
+bool save_world_file( const char* filename );
+// Replaces the world with the one in the file. Fails if the file is missing,
+// of another version, or damaged, and leaves the world as it was.
+bool load_world_file( const char* filename );
+bool world_file_exists( const char* filename );
+
+#define WORLD_CACHE_DIRECTORY "builds/cache"
+
+// Part of the cache key. Bump it with every change to what generate_world() makes from the same
+// params ( eg. a new pass or different noise ), so worlds cached by the older generator are never loaded.
+#define WORLD_GENERATOR_VERSION 1
+
+// The cache file for the world size, layout and world_generator as they are now.
+std::string world_cache_filename( const char* directory );
+// Loads the world for them from the cache. Fails if it hasn't been cached yet.
+bool load_cached_world( const char* directory );
+// Makes the directory if needed, and removes the worlds cached there for other params.
+bool save_cached_world( const char* directory );
+
+#endif